@@ -0,0 +1,259 @@
+#include "DynamicResolution.hpp"
+#include "GLStateCache.hpp"
+#include "ScreenTriangle.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    const float DynamicResolution::MIN_SCALE = 0.5f;
+    const float DynamicResolution::MAX_SCALE = 1.0f;
+
+    // texture unit of the sceneColor sampler of the upscale shader
+    static const GLuint UPSCALE_TEXTURE_UNIT = 12;
+    // weight of a new frame time in the smoothed one
+    static const double SMOOTHING = 0.2;
+    // frames after a change of the scale before the next one, for the average to follow the new scale
+    static const int SETTLE_FRAMES = GpuTimer::QUERY_COUNT + 8;
+    // the scale grows only when the frames are shorter than this fraction of the target
+    static const double HEADROOM = 0.85;
+    // changes of the scale in one step
+    static const float MAX_STEP = 0.1f;
+    static const float MIN_STEP = 0.01f;
+
+    DynamicResolution::DynamicResolution() : frameTimer(GL_TIMESTAMP) {
+        this->sceneFramebuffer = 0;
+        this->colorRenderbuffer = 0;
+        this->depthRenderbuffer = 0;
+        this->resolveFramebuffer = 0;
+        this->resolveTexture = 0;
+        this->outputFramebuffer = 0;
+        this->samples = 0;
+        this->width = 0;
+        this->height = 0;
+        this->targetWidth = 0;
+        this->targetHeight = 0;
+        this->enabled = false;
+        this->scale = MAX_SCALE;
+        // 60 frames per second
+        this->targetMilliseconds = 1000.0 / 60.0;
+        this->lastSampleCount = 0;
+        this->smoothedMilliseconds = -1.0;
+        this->framesSinceChange = 0;
+    }
+
+    void DynamicResolution::init() {
+        // as many samples as the default framebuffer, the scene looks the same at full scale
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGetIntegerv(GL_SAMPLES, &samples);
+
+        glGenFramebuffers(1, &sceneFramebuffer);
+        glGenRenderbuffers(1, &colorRenderbuffer);
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glGenFramebuffers(1, &resolveFramebuffer);
+        glGenTextures(1, &resolveTexture);
+        frameTimer.init();
+    }
+
+    void DynamicResolution::destroy() {
+        frameTimer.destroy();
+        glDeleteTextures(1, &resolveTexture);
+        glDeleteFramebuffers(1, &resolveFramebuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteFramebuffers(1, &sceneFramebuffer);
+        resolveTexture = 0;
+        resolveFramebuffer = 0;
+        depthRenderbuffer = 0;
+        colorRenderbuffer = 0;
+        sceneFramebuffer = 0;
+        width = 0;
+        height = 0;
+        targetWidth = 0;
+        targetHeight = 0;
+    }
+
+    static void allocateRenderbuffer(GLuint renderbuffer, int samples, GLenum internalFormat, int width, int height) {
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        if (samples > 1) {
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, width, height);
+        }
+        else {
+            glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    void DynamicResolution::resize(int width, int height) {
+        this->width = width;
+        this->height = height;
+        if (enabled) {
+            allocateTargets();
+        }
+    }
+
+    void DynamicResolution::allocateTargets() {
+        if (width == targetWidth && height == targetHeight) {
+            return;
+        }
+        targetWidth = width;
+        targetHeight = height;
+
+        // sRGB like the window (GL_FRAMEBUFFER_SRGB), 8 linear bits would band the dark scenes
+        allocateRenderbuffer(colorRenderbuffer, samples, GL_SRGB8_ALPHA8, width, height);
+        allocateRenderbuffer(depthRenderbuffer, samples, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "DynamicResolution: incomplete scene framebuffer" << std::endl;
+        }
+
+        GLStateCache::getInstance().activeTexture(GL_TEXTURE0 + UPSCALE_TEXTURE_UNIT);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, resolveTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolveTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "DynamicResolution: incomplete resolve framebuffer" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void DynamicResolution::setEnabled(bool enabled) {
+        this->enabled = enabled;
+        if (enabled) {
+            allocateTargets();
+        }
+        // starts again from the full size
+        scale = MAX_SCALE;
+        framesSinceChange = 0;
+        smoothedMilliseconds = -1.0;
+    }
+
+    void DynamicResolution::setOutputFramebuffer(GLuint framebuffer) {
+        this->outputFramebuffer = framebuffer;
+    }
+
+    bool DynamicResolution::isEnabled() {
+        return enabled;
+    }
+
+    void DynamicResolution::setTargetMilliseconds(double milliseconds) {
+        this->targetMilliseconds = milliseconds;
+    }
+
+    void DynamicResolution::beginFrame() {
+        frameTimer.begin();
+    }
+
+    void DynamicResolution::endFrame() {
+        frameTimer.end();
+        framesSinceChange++;
+        if (frameTimer.getSampleCount() == lastSampleCount) {
+            return;
+        }
+        lastSampleCount = frameTimer.getSampleCount();
+        // the result of a frame issued before the last change of the scale
+        if (framesSinceChange <= GpuTimer::QUERY_COUNT) {
+            return;
+        }
+
+        double milliseconds = frameTimer.getLastMilliseconds();
+        if (smoothedMilliseconds < 0.0) {
+            smoothedMilliseconds = milliseconds;
+        }
+        else {
+            smoothedMilliseconds += SMOOTHING * (milliseconds - smoothedMilliseconds);
+        }
+        if (enabled) {
+            adaptScale(smoothedMilliseconds);
+        }
+    }
+
+    void DynamicResolution::adaptScale(double frameMilliseconds) {
+        if (framesSinceChange < SETTLE_FRAMES || frameMilliseconds <= 0.0) {
+            return;
+        }
+        // the cost of the scene grows with its pixels, with the square of the scale
+        float wanted = scale * (float)std::sqrt(targetMilliseconds / frameMilliseconds);
+        float next = scale;
+        if (frameMilliseconds > targetMilliseconds) {
+            next = std::max(wanted, scale - MAX_STEP);
+        }
+        else if (frameMilliseconds < targetMilliseconds * HEADROOM) {
+            next = std::min(wanted, scale + MAX_STEP);
+        }
+        next = std::min(std::max(next, MIN_SCALE), MAX_SCALE);
+        if (std::fabs(next - scale) < MIN_STEP) {
+            return;
+        }
+        scale = next;
+        framesSinceChange = 0;
+        smoothedMilliseconds = -1.0;
+    }
+
+    void DynamicResolution::beginScene() {
+        glBindFramebuffer(GL_FRAMEBUFFER, getSceneFramebuffer());
+        glViewport(0, 0, getRenderWidth(), getRenderHeight());
+    }
+
+    void DynamicResolution::endScene(gps::Shader upscaleShader) {
+        if (!enabled) {
+            return;
+        }
+        int renderWidth = getRenderWidth();
+        int renderHeight = getRenderHeight();
+
+        // only the part of the target which was drawn
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+
+        // a multisampled framebuffer cannot be the target of a scaling blit, the scene is drawn instead
+        glViewport(0, 0, width, height);
+        glDisable(GL_DEPTH_TEST);
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.useProgram(upscaleShader.shaderProgram);
+        stateCache.activeTexture(GL_TEXTURE0 + UPSCALE_TEXTURE_UNIT);
+        stateCache.bindTexture(GL_TEXTURE_2D, resolveTexture);
+        glUniform1i(glGetUniformLocation(upscaleShader.shaderProgram, "sceneColor"), UPSCALE_TEXTURE_UNIT);
+        glUniform2f(glGetUniformLocation(upscaleShader.shaderProgram, "renderSize"), (float)renderWidth, (float)renderHeight);
+        glUniform2f(glGetUniformLocation(upscaleShader.shaderProgram, "outputSize"), (float)width, (float)height);
+        ScreenTriangle::getInstance().draw();
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    GLuint DynamicResolution::getSceneFramebuffer() {
+        return enabled ? sceneFramebuffer : outputFramebuffer;
+    }
+
+    int DynamicResolution::getRenderWidth() {
+        return std::max(1, (int)(width * scale + 0.5f));
+    }
+
+    int DynamicResolution::getRenderHeight() {
+        return std::max(1, (int)(height * scale + 0.5f));
+    }
+
+    float DynamicResolution::getScale() {
+        return scale;
+    }
+
+    double DynamicResolution::getFrameMilliseconds() {
+        return std::max(smoothedMilliseconds, 0.0);
+    }
+
+    void DynamicResolution::printStats(std::ostream& out) {
+        out << "Dynamic resolution: " << (enabled ? "on" : "off") << ", " << (int)(scale * 100.0f + 0.5f) << "% ("
+            << getRenderWidth() << "x" << getRenderHeight() << "), GPU frame " << getFrameMilliseconds()
+            << " ms, target " << targetMilliseconds << " ms" << std::endl;
+    }
+
+}
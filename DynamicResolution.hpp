@@ -0,0 +1,92 @@
+#ifndef DynamicResolution_hpp
+#define DynamicResolution_hpp
+
+#include <GL/glew.h>
+
+#include "GpuTimer.hpp"
+#include "Shader.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+// Renders the scene at a fraction of the screen size when the GPU cannot keep up with a target frame time.
+// The scene is drawn to an offscreen target (multisampled like the window), whose used part is resolved
+// and stretched over the output framebuffer (the window) with bilinear filtering. The targets keep the size of the
+// screen, only the viewport changes with the scale, so nothing is reallocated while the scale adapts;
+// they are only allocated while the mode is enabled.
+// The GPU time of the frames is measured with timestamps; the scale follows it a few frames late
+// (the results are read without waiting), in small steps so it does not oscillate.
+class DynamicResolution
+{
+public:
+    // bounds of the scale of both sides of the screen
+    static const float MIN_SCALE;
+    static const float MAX_SCALE;
+
+    DynamicResolution();
+
+    void init();
+    void destroy();
+
+    // the size of the screen; the targets are reallocated when it changed, if the mode is enabled
+    void resize(int width, int height);
+
+    // disabled, the scene is rendered directly to the output framebuffer at the size of the screen
+    void setEnabled(bool enabled);
+    // where the frames end up, 0 - the window; an application framebuffer must have the size given to resize()
+    void setOutputFramebuffer(GLuint framebuffer);
+    bool isEnabled();
+    void setTargetMilliseconds(double milliseconds);
+
+    // enclose the GPU work of the frame; endFrame() adapts the scale to the results read back
+    void beginFrame();
+    void endFrame();
+
+    // binds the framebuffer of the scene and sets the viewport to the render size
+    void beginScene();
+    // resolves the scene and draws it scaled to the output framebuffer, with the upscale shader
+    void endScene(gps::Shader upscaleShader);
+
+    // the framebuffer the scene is drawn to, for the passes which bind their own framebuffer in between
+    GLuint getSceneFramebuffer();
+    int getRenderWidth();
+    int getRenderHeight();
+    float getScale();
+    // smoothed GPU time of the frames
+    double getFrameMilliseconds();
+    void printStats(std::ostream& out);
+
+private:
+    void adaptScale(double frameMilliseconds);
+    // (re)allocates the targets at the size of the screen
+    void allocateTargets();
+
+    GLuint sceneFramebuffer;
+    GLuint colorRenderbuffer;
+    GLuint depthRenderbuffer;
+    // single sampled copy of the scene, sampled by the upscale
+    GLuint resolveFramebuffer;
+    GLuint resolveTexture;
+    GLuint outputFramebuffer;
+    int samples;
+    // of the screen
+    int width;
+    int height;
+    // of the targets, 0 when they are not allocated
+    int targetWidth;
+    int targetHeight;
+
+    bool enabled;
+    float scale;
+    double targetMilliseconds;
+    GpuTimer frameTimer;
+    int lastSampleCount;
+    double smoothedMilliseconds;
+    // frames since the scale last changed, the results of the older frames are ignored
+    int framesSinceChange;
+};
+
+}
+
+#endif /* DynamicResolution_hpp */
@@ -0,0 +1,58 @@
+#include "Frustum.hpp"
+
+namespace gps {
+
+    Frustum::Frustum() {
+        // an infinite frustum, nothing is culled
+        for (int i = 0; i < 6; i++) {
+            planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    Frustum::Frustum(glm::mat4 clipTransformation) {
+        // rows of the matrix (glm is column major)
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(clipTransformation[0][i], clipTransformation[1][i], clipTransformation[2][i], clipTransformation[3][i]);
+        }
+
+        // Gribb & Hartmann: -w <= x, y, z <= w
+        planes[0] = rows[3] + rows[0]; // left
+        planes[1] = rows[3] - rows[0]; // right
+        planes[2] = rows[3] + rows[1]; // bottom
+        planes[3] = rows[3] - rows[1]; // top
+        planes[4] = rows[3] + rows[2]; // near
+        planes[5] = rows[3] - rows[2]; // far
+
+        for (int i = 0; i < 6; i++) {
+            float length = glm::length(glm::vec3(planes[i]));
+            if (length > 0.0f) {
+                planes[i] = planes[i] / length;
+            }
+        }
+    }
+
+    bool Frustum::intersectsBox(glm::vec3 boxMin, glm::vec3 boxMax) {
+        for (int i = 0; i < 6; i++) {
+            // the corner of the box furthest along the normal of the plane
+            glm::vec3 corner(
+                planes[i].x >= 0.0f ? boxMax.x : boxMin.x,
+                planes[i].y >= 0.0f ? boxMax.y : boxMin.y,
+                planes[i].z >= 0.0f ? boxMax.z : boxMin.z);
+            if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Frustum::intersectsSphere(glm::vec3 center, float radius) {
+        for (int i = 0; i < 6; i++) {
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
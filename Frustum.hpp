@@ -0,0 +1,28 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include "glm/glm.hpp"
+
+namespace gps {
+
+// The six planes of a view frustum, used for culling
+class Frustum
+{
+public:
+    Frustum();
+    // The planes are extracted from a (projection * view * model) matrix, so they are expressed
+    // in the space the matrix transforms from - with a model matrix, objects can be tested in object space
+    Frustum(glm::mat4 clipTransformation);
+
+    // conservative tests - false only if the volume is completely outside of one of the planes
+    bool intersectsBox(glm::vec3 boxMin, glm::vec3 boxMax);
+    bool intersectsSphere(glm::vec3 center, float radius);
+
+private:
+    // normal in xyz (pointing inside), distance in w
+    glm::vec4 planes[6];
+};
+
+}
+
+#endif /* Frustum_hpp */
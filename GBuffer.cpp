@@ -0,0 +1,118 @@
+#include "GBuffer.hpp"
+#include "GLStateCache.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+    // internal formats of the color targets, by Target
+    static const GLenum TARGET_FORMATS[GBuffer::TARGET_COUNT] = { GL_SRGB8_ALPHA8, GL_SRGB8_ALPHA8, GL_RG16 };
+    static const GLenum TARGET_PIXEL_FORMATS[GBuffer::TARGET_COUNT] = { GL_RGBA, GL_RGBA, GL_RG };
+    static const int TARGET_BYTES[GBuffer::TARGET_COUNT] = { 4, 4, 4 };
+    static const char* TARGET_SAMPLER_NAMES[GBuffer::TARGET_COUNT] = { "gAlbedo", "gSpecular", "gNormal" };
+    // 24 bit depth, stored in 32 bits
+    static const int DEPTH_BYTES = 4;
+
+    GBuffer::GBuffer() {
+        this->framebuffer = 0;
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            this->targets[i] = 0;
+        }
+        this->depthTexture = 0;
+        this->width = 0;
+        this->height = 0;
+    }
+
+    void GBuffer::init() {
+        glGenFramebuffers(1, &framebuffer);
+        glGenTextures(TARGET_COUNT, targets);
+        glGenTextures(1, &depthTexture);
+    }
+
+    void GBuffer::destroy() {
+        glDeleteTextures(1, &depthTexture);
+        glDeleteTextures(TARGET_COUNT, targets);
+        glDeleteFramebuffers(1, &framebuffer);
+        depthTexture = 0;
+        framebuffer = 0;
+        width = 0;
+        height = 0;
+    }
+
+    static void allocateTarget(GLuint texture, GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        // read with texelFetch, one texel per pixel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    void GBuffer::resize(int width, int height) {
+        if (width == this->width && height == this->height) {
+            return;
+        }
+        this->width = width;
+        this->height = height;
+
+        GLStateCache::getInstance().activeTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT);
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            allocateTarget(targets[i], TARGET_FORMATS[i], TARGET_PIXEL_FORMATS[i], GL_UNSIGNED_BYTE, width, height);
+        }
+        allocateTarget(depthTexture, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        GLenum drawBuffers[TARGET_COUNT];
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, targets[i], 0);
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffers(TARGET_COUNT, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "GBuffer: incomplete framebuffer" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void GBuffer::beginGeometryPass() {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        // every visible pixel is written, the colors need no clear
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void GBuffer::endGeometryPass(GLuint framebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    void GBuffer::bindTextures(gps::Shader shader) {
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.useProgram(shader.shaderProgram);
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            stateCache.activeTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT + i);
+            stateCache.bindTexture(GL_TEXTURE_2D, targets[i]);
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, TARGET_SAMPLER_NAMES[i]), FIRST_TEXTURE_UNIT + i);
+        }
+        stateCache.activeTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT + TARGET_COUNT);
+        stateCache.bindTexture(GL_TEXTURE_2D, depthTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "gDepth"), FIRST_TEXTURE_UNIT + TARGET_COUNT);
+    }
+
+    int GBuffer::getWidth() {
+        return width;
+    }
+
+    int GBuffer::getHeight() {
+        return height;
+    }
+
+    int GBuffer::getBytesPerPixel() {
+        int bytes = DEPTH_BYTES;
+        for (int i = 0; i < TARGET_COUNT; i++) {
+            bytes += TARGET_BYTES[i];
+        }
+        return bytes;
+    }
+
+}
@@ -0,0 +1,56 @@
+#ifndef GBuffer_hpp
+#define GBuffer_hpp
+
+#include <GL/glew.h>
+
+#include "Shader.hpp"
+
+namespace gps {
+
+// Surfaces of the visible fragments for deferred shading, 16 bytes per pixel:
+// - albedo: diffuse color (sRGB 8 bits per channel)
+// - specular: specular color (sRGB), index of the material in the alpha (ambient color and shininess)
+// - normal: eye space normal in two 16 bit components (octahedral mapping, see shaders/include/octahedral.glsl)
+// - depth: the eye space positions are reconstructed from it
+// The geometry pass writes them with gBufferShader, the lighting pass reads them once per pixel.
+class GBuffer
+{
+public:
+    // color targets, in the order of the outputs of the geometry pass
+    enum Target { ALBEDO_TARGET = 0, SPECULAR_TARGET = 1, NORMAL_TARGET = 2, TARGET_COUNT = 3 };
+    // texture unit of the first target, the others and the depth follow it
+    static const GLuint FIRST_TEXTURE_UNIT = 6;
+
+    GBuffer();
+
+    void init();
+    void destroy();
+
+    // reallocates the targets when the size of the screen changed
+    void resize(int width, int height);
+
+    // binds the framebuffer and clears the depths (the pixels left at depth 1 are not lit);
+    // the viewport is kept, the scene may be drawn to a part of the targets
+    void beginGeometryPass();
+    // binds the framebuffer of the lighting pass
+    void endGeometryPass(GLuint framebuffer);
+
+    // binds the targets to the gAlbedo, gSpecular, gNormal and gDepth samplers of the program,
+    // the lighting pass then draws a ScreenTriangle
+    void bindTextures(gps::Shader shader);
+
+    int getWidth();
+    int getHeight();
+    int getBytesPerPixel();
+
+private:
+    GLuint framebuffer;
+    GLuint targets[TARGET_COUNT];
+    GLuint depthTexture;
+    int width;
+    int height;
+};
+
+}
+
+#endif /* GBuffer_hpp */
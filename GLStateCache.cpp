@@ -0,0 +1,118 @@
+#include "GLStateCache.hpp"
+
+namespace gps {
+
+    // a value no GL object or enum can have
+    const GLuint UNKNOWN_STATE = 0xFFFFFFFF;
+
+    GLStateCache& GLStateCache::getInstance() {
+        // the state belongs to the (single) GL context
+        static GLStateCache instance;
+        return instance;
+    }
+
+    GLStateCache::GLStateCache() {
+        invalidate();
+        resetCounters();
+    }
+
+    void GLStateCache::useProgram(GLuint program) {
+        if (program == currentProgram) {
+            stats.programChangesAvoided++;
+            return;
+        }
+        glUseProgram(program);
+        currentProgram = program;
+        stats.programChanges++;
+    }
+
+    void GLStateCache::activeTexture(GLenum unit) {
+        if (unit == currentActiveTexture) {
+            stats.activeTextureChangesAvoided++;
+            return;
+        }
+        glActiveTexture(unit);
+        currentActiveTexture = unit;
+        stats.activeTextureChanges++;
+    }
+
+    void GLStateCache::bindTexture(GLenum target, GLuint texture) {
+        GLuint unit = currentActiveTexture - GL_TEXTURE0;
+        if (currentActiveTexture == UNKNOWN_STATE || unit >= MAX_TEXTURE_UNITS) {
+            // the active unit is not tracked - the binding can't be tracked either
+            glBindTexture(target, texture);
+            stats.textureBindings++;
+            return;
+        }
+
+        std::map<GLenum, GLuint>::iterator it = boundTextures[unit].find(target);
+        if (it != boundTextures[unit].end() && it->second == texture) {
+            stats.textureBindingsAvoided++;
+            return;
+        }
+        glBindTexture(target, texture);
+        boundTextures[unit][target] = texture;
+        stats.textureBindings++;
+    }
+
+    void GLStateCache::bindVertexArray(GLuint vertexArray) {
+        if (vertexArray == currentVertexArray) {
+            stats.vertexArrayBindingsAvoided++;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        currentVertexArray = vertexArray;
+        stats.vertexArrayBindings++;
+    }
+
+    void GLStateCache::depthFunc(GLenum func) {
+        if (func == currentDepthFunc) {
+            stats.depthFuncChangesAvoided++;
+            return;
+        }
+        glDepthFunc(func);
+        currentDepthFunc = func;
+        stats.depthFuncChanges++;
+    }
+
+    void GLStateCache::invalidate() {
+        currentProgram = UNKNOWN_STATE;
+        currentActiveTexture = UNKNOWN_STATE;
+        currentVertexArray = UNKNOWN_STATE;
+        currentDepthFunc = UNKNOWN_STATE;
+        for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            boundTextures[i].clear();
+        }
+    }
+
+    void GLStateCache::beginFrame() {
+        resetCounters();
+    }
+
+    GLStateStats GLStateCache::getStats() {
+        return stats;
+    }
+
+    void GLStateCache::printStats(std::ostream& out) {
+        out << "GL state changes in the last frame (sent / avoided):" << std::endl;
+        out << "  programs: " << stats.programChanges << " / " << stats.programChangesAvoided << std::endl;
+        out << "  active texture units: " << stats.activeTextureChanges << " / " << stats.activeTextureChangesAvoided << std::endl;
+        out << "  texture bindings: " << stats.textureBindings << " / " << stats.textureBindingsAvoided << std::endl;
+        out << "  vertex array bindings: " << stats.vertexArrayBindings << " / " << stats.vertexArrayBindingsAvoided << std::endl;
+        out << "  depth functions: " << stats.depthFuncChanges << " / " << stats.depthFuncChangesAvoided << std::endl;
+    }
+
+    void GLStateCache::resetCounters() {
+        stats.programChanges = 0;
+        stats.activeTextureChanges = 0;
+        stats.textureBindings = 0;
+        stats.vertexArrayBindings = 0;
+        stats.depthFuncChanges = 0;
+        stats.programChangesAvoided = 0;
+        stats.activeTextureChangesAvoided = 0;
+        stats.textureBindingsAvoided = 0;
+        stats.vertexArrayBindingsAvoided = 0;
+        stats.depthFuncChangesAvoided = 0;
+    }
+
+}
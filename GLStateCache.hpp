@@ -0,0 +1,71 @@
+#ifndef GLStateCache_hpp
+#define GLStateCache_hpp
+
+#include <GL/glew.h>
+
+#include <iostream>
+#include <map>
+
+namespace gps {
+
+// state changes during one frame - sent to the driver, and skipped because nothing would have changed
+struct GLStateStats
+{
+    int programChanges;
+    int activeTextureChanges;
+    int textureBindings;
+    int vertexArrayBindings;
+    int depthFuncChanges;
+    int programChangesAvoided;
+    int activeTextureChangesAvoided;
+    int textureBindingsAvoided;
+    int vertexArrayBindingsAvoided;
+    int depthFuncChangesAvoided;
+};
+
+// Remembers the shader program, texture and vertex array bindings and the depth function,
+// so only real changes reach the driver.
+// All the glUseProgram, glActiveTexture, glBindTexture, glBindVertexArray and glDepthFunc calls
+// of the application go through the cache; anything else changing this state must call invalidate().
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    static GLStateCache& getInstance();
+
+    void useProgram(GLuint program);
+    // unit is GL_TEXTURE0 + i, as for glActiveTexture
+    void activeTexture(GLenum unit);
+    // binds to the active texture unit
+    void bindTexture(GLenum target, GLuint texture);
+    void bindVertexArray(GLuint vertexArray);
+    void depthFunc(GLenum func);
+
+    // forgets the tracked state, after it was changed without the cache
+    void invalidate();
+
+    // resets the counters, called once per frame
+    void beginFrame();
+    GLStateStats getStats();
+    void printStats(std::ostream& out);
+
+private:
+    GLStateCache();
+
+    void resetCounters();
+
+    // 0xFFFFFFFF - unknown
+    GLuint currentProgram;
+    GLenum currentActiveTexture;
+    GLuint currentVertexArray;
+    GLenum currentDepthFunc;
+    // texture bound to each target, per texture unit
+    std::map<GLenum, GLuint> boundTextures[MAX_TEXTURE_UNITS];
+
+    GLStateStats stats;
+};
+
+}
+
+#endif /* GLStateCache_hpp */
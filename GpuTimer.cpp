@@ -0,0 +1,124 @@
+#include "GpuTimer.hpp"
+
+namespace gps {
+
+    GpuTimer::GpuTimer(GLenum queryTarget) {
+        this->queryTarget = queryTarget;
+        for (int i = 0; i < 2 * QUERY_COUNT; i++) {
+            this->queries[i] = 0;
+        }
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            this->pending[i] = false;
+        }
+        this->nextQuery = 0;
+        this->running = false;
+        this->total = 0;
+        this->lastResult = 0;
+        this->sampleCount = 0;
+    }
+
+    void GpuTimer::init() {
+        glGenQueries(2 * QUERY_COUNT, queries);
+    }
+
+    void GpuTimer::destroy() {
+        glDeleteQueries(2 * QUERY_COUNT, queries);
+        for (int i = 0; i < 2 * QUERY_COUNT; i++) {
+            queries[i] = 0;
+        }
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            pending[i] = false;
+        }
+    }
+
+    void GpuTimer::begin() {
+        if (queries[0] == 0 || running) {
+            return;
+        }
+        // the oldest query is reused, normally its result is already available
+        collect(nextQuery);
+        if (queryTarget == GL_TIMESTAMP) {
+            glQueryCounter(queries[nextQuery], GL_TIMESTAMP);
+        }
+        else {
+            glBeginQuery(queryTarget, queries[nextQuery]);
+        }
+        running = true;
+    }
+
+    void GpuTimer::end() {
+        if (!running) {
+            return;
+        }
+        if (queryTarget == GL_TIMESTAMP) {
+            glQueryCounter(queries[QUERY_COUNT + nextQuery], GL_TIMESTAMP);
+        }
+        else {
+            glEndQuery(queryTarget);
+        }
+        pending[nextQuery] = true;
+        nextQuery = (nextQuery + 1) % QUERY_COUNT;
+        running = false;
+    }
+
+    void GpuTimer::finish() {
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            collect(i);
+        }
+    }
+
+    void GpuTimer::reset() {
+        // the queries in flight belong to the previous measurement
+        for (int i = 0; i < QUERY_COUNT; i++) {
+            if (pending[i]) {
+                readResult(i);
+                pending[i] = false;
+            }
+        }
+        total = 0;
+        sampleCount = 0;
+    }
+
+    double GpuTimer::getAverageMilliseconds() {
+        // the elapsed times are in nanoseconds
+        return getAverageResult() / 1000000.0;
+    }
+
+    double GpuTimer::getAverageResult() {
+        if (sampleCount == 0) {
+            return 0.0;
+        }
+        return (double)total / sampleCount;
+    }
+
+    double GpuTimer::getLastMilliseconds() {
+        return lastResult / 1000000.0;
+    }
+
+    int GpuTimer::getSampleCount() {
+        return sampleCount;
+    }
+
+    void GpuTimer::collect(int query) {
+        if (!pending[query]) {
+            return;
+        }
+        GLuint64 result = readResult(query);
+        pending[query] = false;
+        total += result;
+        lastResult = result;
+        sampleCount++;
+    }
+
+    GLuint64 GpuTimer::readResult(int query) {
+        GLuint64 result;
+        glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &result);
+        if (queryTarget == GL_TIMESTAMP) {
+            GLuint64 endTime;
+            glGetQueryObjectui64v(queries[QUERY_COUNT + query], GL_QUERY_RESULT, &endTime);
+            result = endTime - result;
+        }
+        return result;
+    }
+
+}
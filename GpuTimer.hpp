@@ -0,0 +1,56 @@
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#include <GL/glew.h>
+
+namespace gps {
+
+// Measures the GPU time of a part of the frame with GL_TIME_ELAPSED queries (or counts its
+// samples with GL_SAMPLES_PASSED). The queries are used round-robin, a result is read a few frames
+// after it was issued so the CPU does not wait for the GPU; the results are accumulated until reset().
+// With GL_TIMESTAMP the time is the difference of two timestamps, such a timer can enclose a GL_TIME_ELAPSED one.
+class GpuTimer
+{
+public:
+    // frames in flight before a result is read back
+    static const int QUERY_COUNT = 4;
+
+    GpuTimer(GLenum queryTarget = GL_TIME_ELAPSED);
+
+    void init();
+    void destroy();
+
+    // the measured commands are issued between begin() and end(), which must not be nested with another timer of the same target
+    void begin();
+    void end();
+    // waits for the queries still in flight and accumulates their results
+    void finish();
+    void reset();
+
+    // for GL_TIME_ELAPSED and GL_TIMESTAMP
+    double getAverageMilliseconds();
+    // the most recent result read back, 0 before the first one
+    double getLastMilliseconds();
+    // average of the query results, in the unit of the query
+    double getAverageResult();
+    int getSampleCount();
+
+private:
+    void collect(int query);
+    // blocks until the result of the query is available
+    GLuint64 readResult(int query);
+
+    GLenum queryTarget;
+    // the second half holds the end timestamps, for GL_TIMESTAMP
+    GLuint queries[2 * QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    int nextQuery;
+    bool running;
+    GLuint64 total;
+    GLuint64 lastResult;
+    int sampleCount;
+};
+
+}
+
+#endif /* GpuTimer_hpp */
@@ -0,0 +1,164 @@
+#include "IndirectDrawBuffer.hpp"
+#include "GLStateCache.hpp"
+
+#include <iostream>
+
+namespace gps {
+
+    IndirectDrawBuffer::IndirectDrawBuffer() {
+        this->commandBuffer = 0;
+        this->materialIndexBuffer = 0;
+        this->capacity = 0;
+        this->uploadedCount = 0;
+        this->multiDrawSupported = false;
+        this->baseInstanceSupported = false;
+        this->submitCount = 0;
+    }
+
+    void IndirectDrawBuffer::init(size_t initialCapacity) {
+        multiDrawSupported = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+        baseInstanceSupported = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &materialIndexBuffer);
+        reserve(initialCapacity);
+
+        std::cout << "Multi-draw indirect: " << (multiDrawSupported ? "supported" : "not supported, drawing one by one") << std::endl;
+    }
+
+    void IndirectDrawBuffer::destroy() {
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &materialIndexBuffer);
+        commandBuffer = 0;
+        materialIndexBuffer = 0;
+        capacity = 0;
+        attachedVertexArrays.clear();
+    }
+
+    void IndirectDrawBuffer::beginFrame() {
+        commands.clear();
+        materialIndices.clear();
+        uploadedCount = 0;
+        submitCount = 0;
+
+        // orphan the storage, so the commands of the previous frame can still be read by the GPU
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, materialIndexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    size_t IndirectDrawBuffer::addCommand(DrawRange range, GLuint materialIndex) {
+        DrawElementsIndirectCommand command;
+        command.count = range.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = range.baseVertex;
+        // selects the material index of this command from the instanced attribute
+        command.baseInstance = (GLuint)commands.size();
+
+        commands.push_back(command);
+        materialIndices.push_back(materialIndex);
+        return commands.size() - 1;
+    }
+
+    void IndirectDrawBuffer::upload() {
+        if (uploadedCount == commands.size()) {
+            return;
+        }
+        if (commands.size() > capacity) {
+            // the new storage is empty - upload everything again
+            reserve(commands.size());
+            uploadedCount = 0;
+        }
+
+        size_t newCount = commands.size() - uploadedCount;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, uploadedCount * sizeof(DrawElementsIndirectCommand),
+            newCount * sizeof(DrawElementsIndirectCommand), &commands[uploadedCount]);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, materialIndexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, uploadedCount * sizeof(GLuint), newCount * sizeof(GLuint), &materialIndices[uploadedCount]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        uploadedCount = commands.size();
+    }
+
+    void IndirectDrawBuffer::submit(size_t firstCommand, size_t commandCount, GLenum indexType) {
+        if (commandCount == 0) {
+            return;
+        }
+
+        if (multiDrawSupported) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+                (GLvoid*)(firstCommand * sizeof(DrawElementsIndirectCommand)), (GLsizei)commandCount, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            submitCount++;
+            return;
+        }
+
+        GLsizeiptr indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        for (size_t i = firstCommand; i < firstCommand + commandCount; i++) {
+            const DrawElementsIndirectCommand& command = commands[i];
+            GLvoid* indexOffset = (GLvoid*)(command.firstIndex * indexSize);
+            if (baseInstanceSupported) {
+                glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, indexType, indexOffset,
+                    command.instanceCount, command.baseVertex, command.baseInstance);
+            }
+            else {
+                // the attribute array is disabled, so the current value of the attribute is used
+                glVertexAttribI1ui(MATERIAL_INDEX_ATTRIBUTE, materialIndices[i]);
+                glDrawElementsBaseVertex(GL_TRIANGLES, command.count, indexType, indexOffset, command.baseVertex);
+            }
+            submitCount++;
+        }
+    }
+
+    void IndirectDrawBuffer::attachToVertexArray(GLuint vertexArray) {
+        if (!baseInstanceSupported || attachedVertexArrays.count(vertexArray) > 0) {
+            return;
+        }
+
+        GLStateCache::getInstance().bindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, materialIndexBuffer);
+        glEnableVertexAttribArray(MATERIAL_INDEX_ATTRIBUTE);
+        glVertexAttribIPointer(MATERIAL_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+        // one value per draw command, selected by its baseInstance
+        glVertexAttribDivisor(MATERIAL_INDEX_ATTRIBUTE, 1);
+        GLStateCache::getInstance().bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        attachedVertexArrays.insert(vertexArray);
+    }
+
+    bool IndirectDrawBuffer::isMultiDrawSupported() {
+        return multiDrawSupported;
+    }
+
+    size_t IndirectDrawBuffer::getCommandCount() {
+        return commands.size();
+    }
+
+    int IndirectDrawBuffer::getSubmitCount() {
+        return submitCount;
+    }
+
+    void IndirectDrawBuffer::reserve(size_t requiredCapacity) {
+        size_t newCapacity = capacity > 0 ? capacity : 64;
+        while (newCapacity < requiredCapacity) {
+            newCapacity *= 2;
+        }
+        capacity = newCapacity;
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, materialIndexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+}
@@ -0,0 +1,73 @@
+#ifndef IndirectDrawBuffer_hpp
+#define IndirectDrawBuffer_hpp
+
+#include <GL/glew.h>
+
+#include "Mesh.hpp"
+
+#include <set>
+#include <vector>
+
+namespace gps {
+
+// Layout defined by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Draw commands of the whole scene, rebuilt every frame and submitted in batches with glMultiDrawElementsIndirect.
+// Every command also carries a material index, which reaches the vertex shader as the per-instance
+// attribute MATERIAL_INDEX_ATTRIBUTE (the command's baseInstance selects its entry).
+// Without multi-draw indirect support, the commands are issued one by one from the CPU copy.
+class IndirectDrawBuffer
+{
+public:
+    static const GLuint MATERIAL_INDEX_ATTRIBUTE = 3;
+
+    IndirectDrawBuffer();
+
+    // creates the buffers, with room for the given number of commands (they grow when needed)
+    void init(size_t initialCapacity);
+    void destroy();
+
+    // starts a new frame - the previous commands are discarded
+    void beginFrame();
+
+    // returns the index of the new command
+    size_t addCommand(DrawRange range, GLuint materialIndex);
+    // sends the commands added since the last upload to the video memory
+    void upload();
+    // draws a range of uploaded commands, using the bound vertex array
+    void submit(size_t firstCommand, size_t commandCount, GLenum indexType);
+
+    // feeds the material indices to the vertex array as an instanced attribute (done once per vertex array)
+    void attachToVertexArray(GLuint vertexArray);
+
+    bool isMultiDrawSupported();
+    size_t getCommandCount();
+    int getSubmitCount();
+
+private:
+    void reserve(size_t requiredCapacity);
+
+    GLuint commandBuffer;
+    GLuint materialIndexBuffer;
+    size_t capacity;
+    size_t uploadedCount;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLuint> materialIndices;
+    std::set<GLuint> attachedVertexArrays;
+    bool multiDrawSupported;
+    bool baseInstanceSupported;
+    // glMultiDrawElementsIndirect (or glDrawElements* in the fallback) calls in the current frame
+    int submitCount;
+};
+
+}
+
+#endif /* IndirectDrawBuffer_hpp */
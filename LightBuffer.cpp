@@ -0,0 +1,192 @@
+#include "LightBuffer.hpp"
+#include "GLStateCache.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace gps {
+
+    LightBuffer::LightBuffer() {
+        this->view = glm::mat4(1.0f);
+        this->inverseView = glm::mat4(1.0f);
+        this->modelView = glm::mat4(1.0f);
+        this->culling = false;
+        this->culledLightCount = 0;
+        this->lightBuffer = 0;
+        this->lightTexture = 0;
+        this->uploaded = false;
+        this->uploadCount = 0;
+    }
+
+    void LightBuffer::init() {
+        glGenBuffers(1, &lightBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, MAX_LIGHTS * sizeof(LightData), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // the shaders fetch the lights texel by texel
+        glGenTextures(1, &lightTexture);
+        GLStateCache::getInstance().activeTexture(GL_TEXTURE0 + LIGHTS_TEXTURE_UNIT);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightBuffer);
+        uploaded = false;
+    }
+
+    void LightBuffer::destroy() {
+        glDeleteTextures(1, &lightTexture);
+        glDeleteBuffers(1, &lightBuffer);
+        lightTexture = 0;
+        lightBuffer = 0;
+        lights.clear();
+        uploadedLights.clear();
+        uploaded = false;
+    }
+
+    void LightBuffer::setViewMatrix(glm::mat4 view, glm::mat4 sceneModel) {
+        this->view = view;
+        this->inverseView = glm::inverse(view);
+        this->modelView = view * sceneModel;
+    }
+
+    void LightBuffer::setProjection(glm::mat4 projection) {
+        this->frustum = gps::Frustum(projection);
+    }
+
+    void LightBuffer::setCulling(bool enabled) {
+        this->culling = enabled;
+    }
+
+    void LightBuffer::clear() {
+        lights.clear();
+        culledLightCount = 0;
+    }
+
+    bool LightBuffer::isCulled(glm::vec3 center, float radius) {
+        // the lights without attenuation reach everything
+        if (!culling || radius < 0.0f) {
+            return false;
+        }
+        if (radius > 0.0f && frustum.intersectsSphere(center, radius)) {
+            return false;
+        }
+        culledLightCount++;
+        return true;
+    }
+
+    size_t LightBuffer::addLight(LightType type, glm::vec3 position, LightSource* light, glm::vec4 target, glm::vec4 attenuation, ShadowSource shadow, float radius) {
+        if (lights.size() >= MAX_LIGHTS) {
+            std::cout << "LightBuffer: more than " << MAX_LIGHTS << " lights, the others are ignored" << std::endl;
+            return NO_LIGHT;
+        }
+        LightData data;
+        data.position = glm::vec4(position, (float)type);
+        data.target = target;
+        data.color = glm::vec4(light->getLightColor(), light->getAmbientStrength());
+        data.attenuation = attenuation;
+        data.parameters = glm::vec4(light->getSpecularStrength(), (float)shadow, radius, 0.0f);
+        data.shadowRect = glm::vec4(0.0f);
+        data.shadowMatrix = glm::mat4(1.0f);
+        lights.push_back(data);
+        return lights.size() - 1;
+    }
+
+    void LightBuffer::addDirectionalLight(LightSource* light, bool shadowed) {
+        // the position of a directional light is its direction
+        glm::vec3 direction = glm::normalize(glm::mat3(view) * light->getLightPosition());
+        addLight(LIGHT_DIRECTIONAL, direction, light, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f), glm::vec4(1.0f, 0.0f, 0.0f, -1.0f), shadowed ? SHADOW_MAP : SHADOW_NONE, -1.0f);
+    }
+
+    void LightBuffer::addPointLight(LightSource* light) {
+        glm::vec3 position = light->getLightPositionEye(modelView);
+        float radius = light->computeRadius();
+        if (isCulled(position, radius)) {
+            return;
+        }
+        addLight(LIGHT_POINT, position, light, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f), glm::vec4(light->getAttenuation(), -1.0f), SHADOW_NONE, radius);
+    }
+
+    size_t LightBuffer::addSpotLight(LightSource* light, float cutOff, float outerCone) {
+        glm::vec3 position = light->getLightPositionEye(modelView);
+        glm::vec3 direction = glm::normalize(position - light->getLightTargetEye(modelView));
+        float radius = light->computeRadius();
+
+        // the smallest sphere around the cone of the given length and outer angle
+        glm::vec3 boundsCenter = position;
+        float boundsRadius = radius;
+        float sine = std::sqrt(glm::max(1.0f - outerCone * outerCone, 0.0f));
+        if (outerCone > 0.0f && outerCone <= sine) {
+            // wider than 90 degrees: the circle of the base
+            boundsCenter = position - direction * (radius * outerCone);
+            boundsRadius = radius * sine;
+        }
+        else if (outerCone > sine) {
+            // narrow: the sphere through the apex and the circle of the base
+            boundsCenter = position - direction * (radius / (2.0f * outerCone));
+            boundsRadius = radius / (2.0f * outerCone);
+        }
+        if (isCulled(boundsCenter, boundsRadius)) {
+            return NO_LIGHT;
+        }
+        return addLight(LIGHT_SPOT, position, light, glm::vec4(direction, cutOff), glm::vec4(light->getAttenuation(), outerCone), SHADOW_NONE, radius);
+    }
+
+    void LightBuffer::addFlashLight(LightSource* light, float cutOff, float outerCone) {
+        glm::vec3 direction = glm::normalize(glm::mat3(view) * (light->getLightTarget() - light->getLightPosition()));
+        addLight(LIGHT_FLASH, direction, light, glm::vec4(light->getLightTarget(), cutOff), glm::vec4(1.0f, 0.0f, 0.0f, outerCone), SHADOW_NONE, -1.0f);
+    }
+
+    void LightBuffer::setAtlasShadow(size_t lightIndex, glm::mat4 lightSpaceTrMatrix, glm::vec4 atlasRect) {
+        if (lightIndex >= lights.size()) {
+            return;
+        }
+        // the shaders have the eye space positions of the fragments
+        lights[lightIndex].parameters.y = (float)SHADOW_ATLAS;
+        lights[lightIndex].shadowRect = atlasRect;
+        lights[lightIndex].shadowMatrix = lightSpaceTrMatrix * inverseView;
+    }
+
+    void LightBuffer::upload() {
+        if (uploaded && lights.size() == uploadedLights.size()
+            && (lights.empty() || std::memcmp(&lights[0], &uploadedLights[0], lights.size() * sizeof(LightData)) == 0)) {
+            return;
+        }
+
+        // the light count is a uniform, an empty set needs no upload
+        if (!lights.empty()) {
+            glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, lights.size() * sizeof(LightData), &lights[0]);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        uploadedLights = lights;
+        uploaded = true;
+        uploadCount++;
+    }
+
+    void LightBuffer::bind(gps::Shader shader) {
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.useProgram(shader.shaderProgram);
+        stateCache.activeTexture(GL_TEXTURE0 + LIGHTS_TEXTURE_UNIT);
+        stateCache.bindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "lightData"), LIGHTS_TEXTURE_UNIT);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "lightCount"), (GLint)lights.size());
+    }
+
+    size_t LightBuffer::getLightCount() {
+        return lights.size();
+    }
+
+    size_t LightBuffer::getCulledLightCount() {
+        return culledLightCount;
+    }
+
+    const std::vector<LightData>& LightBuffer::getLights() {
+        return lights;
+    }
+
+    int LightBuffer::getUploadCount() {
+        return uploadCount;
+    }
+
+}
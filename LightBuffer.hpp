@@ -0,0 +1,131 @@
+#ifndef LightBuffer_hpp
+#define LightBuffer_hpp
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+#include "LightSource.hpp"
+#include "Shader.hpp"
+
+#include <vector>
+
+namespace gps {
+
+// kinds of lights of the lighting shader, see shaders/include/lights.glsl
+enum LightType
+{
+    LIGHT_DIRECTIONAL = 0,
+    // attenuated light shining in all directions
+    LIGHT_POINT = 1,
+    // point light limited to a cone
+    LIGHT_SPOT = 2,
+    // directional light limited to a cone around the camera's front direction
+    LIGHT_FLASH = 3
+};
+
+// shadow map sampled for a light, see shaders/include/shadow.glsl
+enum ShadowSource
+{
+    SHADOW_NONE = 0,
+    // the shadow map of the directional light
+    SHADOW_MAP = 1,
+    // a tile of the ShadowAtlas
+    SHADOW_ATLAS = 2
+};
+
+// one light in the texture buffer, 10 RGBA32F texels (see fetchLight in shaders/include/lights.glsl)
+struct LightData
+{
+    // xyz - eye space position (direction towards the light for directional and flash lights), w - type
+    glm::vec4 position;
+    // xyz - eye space direction from the target to a spot light (front direction of the camera for the
+    // flash light), w - cosine of the cut-off angle
+    glm::vec4 target;
+    // rgb - color, w - ambient strength
+    glm::vec4 color;
+    // constant, linear and quadratic attenuation, w - cosine of the outer cone
+    glm::vec4 attenuation;
+    // x - specular strength, y - ShadowSource, z - radius (see LightSource::computeRadius), negative if unlimited
+    glm::vec4 parameters;
+    // offset (xy) and scale (zw) of the tile in the shadow atlas
+    glm::vec4 shadowRect;
+    // from eye space to the clip space of the light's shadow map in the atlas
+    glm::mat4 shadowMatrix;
+};
+
+// The lights of the scene in one texture buffer, read by the forward and deferred lighting shaders.
+// Changing the lighting mode only changes the content of the buffer, there is no program switch.
+// A texture buffer has no size limit of a uniform block, so a frame can have a thousand lights.
+// With culling on, the attenuated lights whose range (sphere, or the sphere around the cone of a spot light)
+// is outside the view frustum, or which are too dim to be seen at all, are not added.
+class LightBuffer
+{
+public:
+    // capacity of the buffer
+    static const int MAX_LIGHTS = 1024;
+    // texture unit of the lightData sampler
+    static const GLuint LIGHTS_TEXTURE_UNIT = 5;
+    // index returned for the lights which were not added
+    static const size_t NO_LIGHT = (size_t)-1;
+
+    LightBuffer();
+
+    void init();
+    void destroy();
+
+    // the lights are transformed to eye space on the CPU, once per frame: the view matrix of the frame
+    // and the model matrix of the scene (in which the light positions are given)
+    void setViewMatrix(glm::mat4 view, glm::mat4 sceneModel);
+    // the projection of the camera, the frustum in which the lights are kept
+    void setProjection(glm::mat4 projection);
+    void setCulling(bool enabled);
+
+    // starts a new set of lights
+    void clear();
+    void addDirectionalLight(LightSource* light, bool shadowed);
+    void addPointLight(LightSource* light);
+    // the angles are given by their cosines; returns the index of the light, NO_LIGHT if it was culled
+    size_t addSpotLight(LightSource* light, float cutOff, float outerCone);
+    // the flash light is at the camera, its shadows are hidden behind the objects casting them
+    void addFlashLight(LightSource* light, float cutOff, float outerCone);
+    // the light is shadowed by a tile of the shadow atlas; lightSpaceTrMatrix transforms from world space
+    void setAtlasShadow(size_t lightIndex, glm::mat4 lightSpaceTrMatrix, glm::vec4 atlasRect);
+    // sends the lights to the video memory, if they changed since the last upload
+    void upload();
+
+    // binds the buffer to the lightData sampler of the program and sends the light count
+    void bind(gps::Shader shader);
+
+    size_t getLightCount();
+    // lights culled since the last clear()
+    size_t getCulledLightCount();
+    // the lights of the frame, in eye space, in the order of the buffer
+    const std::vector<LightData>& getLights();
+    int getUploadCount();
+
+private:
+    size_t addLight(LightType type, glm::vec3 position, LightSource* light, glm::vec4 target, glm::vec4 attenuation, ShadowSource shadow, float radius);
+    // true (and counted) if the light reaching the sphere around center is culled
+    bool isCulled(glm::vec3 center, float radius);
+
+    glm::mat4 view;
+    glm::mat4 inverseView;
+    glm::mat4 modelView;
+    // in eye space
+    gps::Frustum frustum;
+    bool culling;
+    size_t culledLightCount;
+    GLuint lightBuffer;
+    GLuint lightTexture;
+    std::vector<LightData> lights;
+    // content of the buffer, to skip the uploads of unchanged lights
+    std::vector<LightData> uploadedLights;
+    bool uploaded;
+    int uploadCount;
+};
+
+}
+
+#endif /* LightBuffer_hpp */
@@ -1,5 +1,7 @@
 #include "LightSource.hpp"
 
+#include <cmath>
+
 LightSource::LightSource(glm::vec3 lightPosition, glm::vec3 lightTarget, glm::vec3 lightColor) {
     this->transformationMatrix = glm::mat4(1.0f);
     this->lightTarget = lightTarget;
@@ -8,6 +10,7 @@ LightSource::LightSource(glm::vec3 lightPosition, glm::vec3 lightTarget, glm::ve
 	this->lightColor = lightColor;
     this->ambientStrength = 1.0;
     this->specularStrength = 1.0;
+    this->attenuation = glm::vec3(1.0f, 0.0f, 0.0f);
 }
 
 void LightSource::setTransformationMatrix(glm::mat4 newTransformationMatrix) {
@@ -40,6 +43,14 @@ glm::vec3 LightSource::getLightDir() {
 glm::vec3 LightSource::getLightPosition() {
     return this->lightPosition;
 }
+glm::vec3 LightSource::getLightPositionEye(glm::mat4 modelView) {
+    return glm::vec3(modelView * glm::vec4(lightPosition, 1.0f));
+}
+
+glm::vec3 LightSource::getLightTargetEye(glm::mat4 modelView) {
+    return glm::vec3(modelView * glm::vec4(lightTarget, 1.0f));
+}
+
 glm::vec3 LightSource::getLightColor() {
 	return this->lightColor;
 }
@@ -51,6 +62,29 @@ float LightSource::getSpecularStrength() {
     return this->specularStrength;
 }
 
+glm::vec3 LightSource::getAttenuation() {
+    return this->attenuation;
+}
+
+float LightSource::computeRadius() {
+    // constant + linear * d + quadratic * d^2 = brightest color component / threshold
+    float constant = attenuation.x;
+    float linear = attenuation.y;
+    float quadratic = attenuation.z;
+    float brightness = glm::max(lightColor.r, glm::max(lightColor.g, lightColor.b));
+    float limit = brightness / LIGHT_INTENSITY_THRESHOLD - constant;
+    if (limit <= 0.0f) {
+        return 0.0f;
+    }
+    if (quadratic > 0.0f) {
+        return (-linear + std::sqrt(linear * linear + 4.0f * quadratic * limit)) / (2.0f * quadratic);
+    }
+    if (linear > 0.0f) {
+        return limit / linear;
+    }
+    return -1.0f;
+}
+
 glm::vec3 LightSource::getLightTarget() {
     return this->lightTarget;
 }
@@ -64,11 +98,29 @@ glm::mat4 LightSource::computeLightSpaceTrMatrixDirectionalLight() {
     return lightSpaceTrMatrix;
 }
 
+glm::mat4 LightSource::computeLightSpaceTrMatrixSpotLight(glm::mat4 sceneModel, float coneAngle) {
+    glm::vec3 position = glm::vec3(sceneModel * glm::vec4(lightPosition, 1.0f));
+    glm::vec3 target = glm::vec3(sceneModel * glm::vec4(lightTarget, 1.0f));
+    // the lamps point (almost) straight down, where the usual up vector cannot be used
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    if (glm::abs(glm::dot(glm::normalize(target - position), up)) > 0.99f) {
+        up = glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+    glm::mat4 lightView = glm::lookAt(position, target, up);
+    const GLfloat near_plane = 1.0f, far_plane = 200.0f;
+    glm::mat4 lightProjection = glm::perspective(glm::radians(2.0f * coneAngle), 1.0f, near_plane, far_plane);
+    return lightProjection * lightView;
+}
+
 void LightSource::setLightAttributes(float ambientStrength, float specularStrength) {
     this->ambientStrength = ambientStrength;
     this->specularStrength = specularStrength;
 }
 
+void LightSource::setAttenuation(glm::vec3 attenuation) {
+    this->attenuation = attenuation;
+}
+
 void LightSource::move(gps::MOVE_DIRECTION direction) {
     switch (direction) {
     case gps::MOVE_LEFT: {
@@ -3,6 +3,10 @@
 #include "Camera.hpp"
 
 #pragma once
+
+// the lights are ignored where they are dimmer than this fraction of their color (under one step of an 8 bit channel)
+const float LIGHT_INTENSITY_THRESHOLD = 1.0f / 256.0f;
+
 class LightSource {
 public:
     LightSource(glm::vec3 lightPosition, glm::vec3 lightTarget, glm::vec3 lightColor);
@@ -11,15 +15,26 @@ public:
     void setLightTarget(glm::vec3 lightTarget);
     void setLightColor(glm::vec3 lightColor);
     void setLightAttributes(float ambientStrength, float specularStrength);
+    // constant, linear and quadratic attenuation with the distance; (1, 0, 0) - not attenuated
+    void setAttenuation(glm::vec3 attenuation);
     glm::mat4 getTransformationMatrix();
     glm::vec3 getLightDir();
     glm::vec3 getLightColor();
     glm::vec3 getLightTarget();
     glm::vec3 getLightPosition();
+    // the position and target transformed to eye space (by the model-view matrix of the scene)
+    glm::vec3 getLightPositionEye(glm::mat4 modelView);
+    glm::vec3 getLightTargetEye(glm::mat4 modelView);
     float getAmbientStrength();
     float getSpecularStrength();
+    glm::vec3 getAttenuation();
+    // distance at which the attenuated light falls under LIGHT_INTENSITY_THRESHOLD, negative if it reaches infinitely
+    float computeRadius();
     void move(gps::MOVE_DIRECTION direction);
     glm::mat4 computeLightSpaceTrMatrixDirectionalLight();
+    // perspective projection from the light towards its target, covering a cone of the given half angle (degrees);
+    // the light is placed in the world by the model matrix of the scene
+    glm::mat4 computeLightSpaceTrMatrixSpotLight(glm::mat4 sceneModel, float coneAngle);
 
 private:
     void rotate(float angle, glm::vec3 axis);
@@ -32,5 +47,6 @@ private:
     glm::vec3 lightColor;
     float ambientStrength;
     float specularStrength;
+    glm::vec3 attenuation;
 };
 
@@ -0,0 +1,310 @@
+#include "MaterialLibrary.hpp"
+#include "GLStateCache.hpp"
+#include "TextureResidency.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace gps {
+
+    // sampler uniforms of the slots, bound to texture unit = slot
+    static const char* SLOT_SAMPLER_NAMES[TEXTURE_SLOT_COUNT] = { "ambientTextures", "diffuseTextures", "specularTextures" };
+
+    MaterialLibrary& MaterialLibrary::getInstance() {
+        // the texture arrays are shared by all the models of the context
+        static MaterialLibrary instance;
+        return instance;
+    }
+
+    MaterialLibrary::MaterialLibrary() {
+        this->materialBuffer = 0;
+
+        // material 0 is plain white, for the meshes without a material
+        Material defaultMaterial;
+        defaultMaterial.ambient = glm::vec3(1.0f);
+        defaultMaterial.diffuse = glm::vec3(1.0f);
+        defaultMaterial.specular = glm::vec3(0.0f);
+        defaultMaterial.shininess = 32.0f;
+        std::string noTextures[TEXTURE_SLOT_COUNT];
+        addMaterial(defaultMaterial, noTextures);
+    }
+
+    GLuint MaterialLibrary::addMaterial(const Material& parameters, const std::string texturePaths[TEXTURE_SLOT_COUNT]) {
+        if (materials.size() >= MAX_MATERIALS) {
+            std::cerr << "WARNING: more than " << MAX_MATERIALS << " materials, using the default material" << std::endl;
+            return 0;
+        }
+
+        MaterialEntry material;
+        material.parameters = parameters;
+        // pow(x, 0) would light up the whole surface
+        material.parameters.shininess = std::max(parameters.shininess, 1.0f);
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            material.paths[slot] = texturePaths[slot];
+            material.arrays[slot] = -1;
+            material.layers[slot] = -1;
+        }
+        material.bindingKey = 0;
+        materials.push_back(material);
+        return (GLuint)(materials.size() - 1);
+    }
+
+    void MaterialLibrary::build() {
+        GLint maxLayers = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+        // assign a layer to every new image, in an array of its size
+        size_t firstNewArray = arrays.size();
+        for (size_t m = 0; m < materials.size(); m++) {
+            for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+                const std::string& path = materials[m].paths[slot];
+                if (path.empty() || textureLocations.count(path) > 0) {
+                    continue;
+                }
+                int width, height, channels;
+                if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+                    fprintf(stderr, "ERROR: could not load %s\n", path.c_str());
+                    continue;
+                }
+
+                size_t a = firstNewArray;
+                while (a < arrays.size() && (arrays[a].width != width || arrays[a].height != height || (GLint)arrays[a].paths.size() >= maxLayers)) {
+                    a++;
+                }
+                if (a == arrays.size()) {
+                    TextureArray textureArray;
+                    textureArray.id = 0;
+                    textureArray.width = width;
+                    textureArray.height = height;
+                    arrays.push_back(textureArray);
+                }
+                textureLocations[path] = std::make_pair((int)a, (GLint)arrays[a].paths.size());
+                arrays[a].paths.push_back(path);
+            }
+        }
+
+        // upload the new arrays
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        for (size_t a = firstNewArray; a < arrays.size(); a++) {
+            TextureArray& textureArray = arrays[a];
+            glGenTextures(1, &textureArray.id);
+            stateCache.bindTexture(GL_TEXTURE_2D_ARRAY, textureArray.id);
+            UploadTextureArray(textureArray.paths, textureArray.width, textureArray.height, 0);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            stateCache.bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+            // the residency manager may drop the top mips of the array and reload them from the files later
+            std::vector<std::string> paths = textureArray.paths;
+            int width = textureArray.width;
+            int height = textureArray.height;
+            TextureResidency::getInstance().registerTexture(textureArray.id, GL_TEXTURE_2D_ARRAY, [paths, width, height](GLuint, int firstLevel) {
+                return UploadTextureArray(paths, width, height, firstLevel);
+            });
+        }
+
+        // resolve the layers of the materials and group them by the arrays they use
+        bindings.clear();
+        for (size_t m = 0; m < materials.size(); m++) {
+            MaterialEntry& material = materials[m];
+            std::vector<int> binding(TEXTURE_SLOT_COUNT, -1);
+            for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+                std::map<std::string, std::pair<int, GLint> >::iterator it = textureLocations.find(material.paths[slot]);
+                if (it != textureLocations.end()) {
+                    material.arrays[slot] = it->second.first;
+                    material.layers[slot] = it->second.second;
+                }
+                binding[slot] = material.arrays[slot];
+            }
+
+            size_t key = 0;
+            while (key < bindings.size() && bindings[key] != binding) {
+                key++;
+            }
+            if (key == bindings.size()) {
+                bindings.push_back(binding);
+            }
+            material.bindingKey = (GLuint)key;
+        }
+
+        // the whole table, in the std140 layout of the Materials block
+        std::vector<MaterialData> materialData(MAX_MATERIALS);
+        for (size_t m = 0; m < materials.size(); m++) {
+            const Material& parameters = materials[m].parameters;
+            materialData[m].ambient = glm::vec4(parameters.ambient, 1.0f);
+            materialData[m].diffuse = glm::vec4(parameters.diffuse, 1.0f);
+            materialData[m].specular = glm::vec4(parameters.specular, parameters.shininess);
+            materialData[m].textureLayers = glm::ivec4(materials[m].layers[AMBIENT_TEXTURE], materials[m].layers[DIFFUSE_TEXTURE], materials[m].layers[SPECULAR_TEXTURE], 0);
+        }
+        if (materialBuffer == 0) {
+            glGenBuffers(1, &materialBuffer);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, materialData.size() * sizeof(MaterialData), &materialData[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIALS_BINDING_POINT, materialBuffer);
+
+        std::cout << "Materials: " << materials.size() << " in " << arrays.size() << " texture array(s)" << std::endl;
+    }
+
+    void MaterialLibrary::destroy() {
+        for (size_t a = 0; a < arrays.size(); a++) {
+            TextureResidency::getInstance().unregisterTexture(arrays[a].id);
+            glDeleteTextures(1, &arrays[a].id);
+        }
+        arrays.clear();
+        textureLocations.clear();
+        preparedPrograms.clear();
+        glDeleteBuffers(1, &materialBuffer);
+        materialBuffer = 0;
+    }
+
+    void MaterialLibrary::bind(gps::Shader shader, GLuint materialIndex) {
+        if (materialIndex >= materials.size()) {
+            materialIndex = 0;
+        }
+
+        bindTable(shader);
+
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        const MaterialEntry& material = materials[materialIndex];
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            if (material.arrays[slot] < 0) {
+                // not sampled - whatever is bound to the unit can stay there
+                continue;
+            }
+            GLuint arrayId = arrays[material.arrays[slot]].id;
+            stateCache.activeTexture(GL_TEXTURE0 + slot);
+            stateCache.bindTexture(GL_TEXTURE_2D_ARRAY, arrayId);
+            TextureResidency::getInstance().touch(arrayId);
+        }
+    }
+
+    void MaterialLibrary::bindTable(gps::Shader shader) {
+        // once per program: the material buffer and the texture units of the slots
+        if (preparedPrograms.count(shader.shaderProgram) > 0) {
+            return;
+        }
+        GLuint blockIndex = glGetUniformBlockIndex(shader.shaderProgram, "Materials");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader.shaderProgram, blockIndex, MATERIALS_BINDING_POINT);
+        }
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            glUniform1i(glGetUniformLocation(shader.shaderProgram, SLOT_SAMPLER_NAMES[slot]), slot);
+        }
+        preparedPrograms.insert(shader.shaderProgram);
+    }
+
+    void MaterialLibrary::forgetProgram(GLuint shaderProgram) {
+        preparedPrograms.erase(shaderProgram);
+    }
+
+    GLuint MaterialLibrary::getBindingKey(GLuint materialIndex) {
+        if (materialIndex >= materials.size()) {
+            return 0;
+        }
+        return materials[materialIndex].bindingKey;
+    }
+
+    size_t MaterialLibrary::getMaterialCount() {
+        return materials.size();
+    }
+
+    size_t MaterialLibrary::getArrayCount() {
+        return arrays.size();
+    }
+
+    static float srgbToLinear(unsigned char value) {
+        float c = value / 255.0f;
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static unsigned char linearToSrgb(float c) {
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        return (unsigned char)std::min(std::max(c * 255.0f + 0.5f, 0.0f), 255.0f);
+    }
+
+    // Halves the RGBA image in place with a 2x2 box filter, averaging the colors in linear space like the mip chain
+    static void halveImage(unsigned char* pixels, int& width, int& height) {
+        int newWidth = std::max(1, width / 2);
+        int newHeight = std::max(1, height / 2);
+        for (int y = 0; y < newHeight; y++) {
+            for (int x = 0; x < newWidth; x++) {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                const unsigned char* texels[4] = {
+                    pixels + (y0 * width + x0) * 4, pixels + (y0 * width + x1) * 4,
+                    pixels + (y1 * width + x0) * 4, pixels + (y1 * width + x1) * 4
+                };
+                // the destination never overlaps a source texel which is still needed
+                unsigned char* out = pixels + (y * newWidth + x) * 4;
+                float color[3] = { 0.0f, 0.0f, 0.0f };
+                int alpha = 0;
+                for (int t = 0; t < 4; t++) {
+                    for (int c = 0; c < 3; c++) {
+                        color[c] += srgbToLinear(texels[t][c]);
+                    }
+                    alpha += texels[t][3];
+                }
+                for (int c = 0; c < 3; c++) {
+                    out[c] = linearToSrgb(color[c] * 0.25f);
+                }
+                out[3] = (unsigned char)((alpha + 2) / 4);
+            }
+        }
+        width = newWidth;
+        height = newHeight;
+    }
+
+    // Uploads the images into the layers of the (bound) array texture; the levels above firstLevel are
+    // skipped by downsampling the images before the upload, the rest of the chain is generated from them
+    bool MaterialLibrary::UploadTextureArray(const std::vector<std::string>& paths, int width, int height, int firstLevel) {
+        GLsizei levelWidth = std::max(1, width >> firstLevel);
+        GLsizei levelHeight = std::max(1, height >> firstLevel);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB, levelWidth, levelHeight, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        bool loaded = true;
+        for (size_t layer = 0; layer < paths.size(); layer++) {
+            int x, y, n;
+            int force_channels = 4;
+            unsigned char* image_data = stbi_load(paths[layer].c_str(), &x, &y, &n, force_channels);
+            if (!image_data || x != width || y != height) {
+                fprintf(stderr, "ERROR: could not load %s\n", paths[layer].c_str());
+                stbi_image_free(image_data);
+                loaded = false;
+                continue;
+            }
+            // NPOT check
+            if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
+                fprintf(stderr, "WARNING: texture %s is not power-of-2 dimensions\n", paths[layer].c_str());
+            }
+
+            // flip the rows, OpenGL expects the bottom row first
+            int width_in_bytes = x * 4;
+            std::vector<unsigned char> row(width_in_bytes);
+            for (int r = 0; r < y / 2; r++) {
+                unsigned char* top = image_data + r * width_in_bytes;
+                unsigned char* bottom = image_data + (y - r - 1) * width_in_bytes;
+                std::copy(top, top + width_in_bytes, row.begin());
+                std::copy(bottom, bottom + width_in_bytes, top);
+                std::copy(row.begin(), row.end(), bottom);
+            }
+
+            for (int level = 0; level < firstLevel; level++) {
+                halveImage(image_data, x, y);
+            }
+
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, x, y, 1, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+            stbi_image_free(image_data);
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        return loaded;
+    }
+
+}
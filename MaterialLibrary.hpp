@@ -0,0 +1,107 @@
+#ifndef MaterialLibrary_hpp
+#define MaterialLibrary_hpp
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+#include "Mesh.hpp"
+#include "Shader.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+// Textures of a material, by their role
+enum TextureSlot { AMBIENT_TEXTURE = 0, DIFFUSE_TEXTURE = 1, SPECULAR_TEXTURE = 2, TEXTURE_SLOT_COUNT = 3 };
+
+// Layout of a material in the Materials uniform block (std140)
+struct MaterialData
+{
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    // shininess in w
+    glm::vec4 specular;
+    // layers of the ambient, diffuse and specular textures, -1 if there is none
+    glm::ivec4 textureLayers;
+};
+
+// The materials of all the loaded models.
+// Textures of the same size are packed into the layers of GL_TEXTURE_2D_ARRAYs. The colors, shininess
+// and texture layers of all the materials are in one uniform buffer, which the shaders index with
+// the per draw material index - a change of material needs no uniform upload.
+// Meshes with different materials can then be drawn by one multi-draw, as long as their textures
+// are in the same arrays (same binding key).
+class MaterialLibrary
+{
+public:
+    // size of the materials array in the shaders
+    static const int MAX_MATERIALS = 64;
+    // uniform buffer binding point of the Materials block
+    static const GLuint MATERIALS_BINDING_POINT = 0;
+
+    static MaterialLibrary& getInstance();
+
+    // paths of the textures of the material, by slot (empty when there is none); returns the index of the material
+    GLuint addMaterial(const Material& parameters, const std::string texturePaths[TEXTURE_SLOT_COUNT]);
+
+    // loads the textures of the materials added since the last call into texture arrays,
+    // and uploads the material buffer
+    void build();
+    void destroy();
+
+    // binds the texture arrays of the material to the texture units of their slots
+    void bind(gps::Shader shader, GLuint materialIndex);
+    // connects the Materials block and the samplers of the program (once), for the shaders
+    // which read the material table without drawing a mesh
+    void bindTable(gps::Shader shader);
+    // the program was deleted, its name may be reused by a new program
+    void forgetProgram(GLuint shaderProgram);
+    // equal for materials which use the same texture arrays
+    GLuint getBindingKey(GLuint materialIndex);
+
+    size_t getMaterialCount();
+    size_t getArrayCount();
+
+private:
+    struct TextureArray
+    {
+        GLuint id;
+        int width;
+        int height;
+        std::vector<std::string> paths;
+    };
+
+    struct MaterialEntry
+    {
+        Material parameters;
+        std::string paths[TEXTURE_SLOT_COUNT];
+        // index in arrays and layer of every slot, -1 if the slot has no texture
+        int arrays[TEXTURE_SLOT_COUNT];
+        GLint layers[TEXTURE_SLOT_COUNT];
+        GLuint bindingKey;
+    };
+
+    MaterialLibrary();
+
+    // uploads the images into the layers of the (bound) array texture, with the mip chain starting
+    // at level firstLevel of the full one (0 - the images at their own size)
+    static bool UploadTextureArray(const std::vector<std::string>& paths, int width, int height, int firstLevel);
+
+    std::vector<MaterialEntry> materials;
+    std::vector<TextureArray> arrays;
+    // array and layer of every loaded image
+    std::map<std::string, std::pair<int, GLint> > textureLocations;
+    // combinations of arrays used by the materials, one per binding key
+    std::vector<std::vector<int> > bindings;
+    GLuint materialBuffer;
+    // programs whose Materials block and samplers are set up
+    std::set<GLuint> preparedPrograms;
+};
+
+}
+
+#endif /* MaterialLibrary_hpp */
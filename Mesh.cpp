@@ -1,71 +1,67 @@
 #include "Mesh.hpp"
+#include "IndirectDrawBuffer.hpp"
+#include "MaterialLibrary.hpp"
+
 namespace gps {
 
 	/* Mesh Constructor */
-	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures)
+	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, GLuint materialIndex)
 	{
 		this->vertices = vertices;
 		this->indices = indices;
-		this->textures = textures;
+		this->materialIndex = materialIndex;
 
-		this->setupMesh();
-	}
+		this->boundsMin = glm::vec3(0.0f);
+		this->boundsMax = glm::vec3(0.0f);
+		if (!vertices.empty()) {
+			this->boundsMin = vertices[0].Position;
+			this->boundsMax = vertices[0].Position;
+			for (size_t i = 1; i < vertices.size(); i++) {
+				this->boundsMin = glm::min(this->boundsMin, vertices[i].Position);
+				this->boundsMax = glm::max(this->boundsMax, vertices[i].Position);
+			}
+		}
 
-	Buffers Mesh::getBuffers() {
-	    return this->buffers;
+		this->drawRange.baseVertex = 0;
+		this->drawRange.firstIndex = 0;
+		this->drawRange.indexCount = (GLsizei)indices.size();
 	}
 
-	/* Mesh drawing function - also applies associated textures */
-	void Mesh::Draw(gps::Shader shader)
-	{
-		shader.useShaderProgram();
-
-		//set textures
-		for (GLuint i = 0; i < textures.size(); i++)
-		{
-			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
-		}
-
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+	DrawRange Mesh::getDrawRange() {
+	    return this->drawRange;
+	}
 
-        for(GLuint i = 0; i < this->textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
+	void Mesh::setDrawRange(DrawRange drawRange) {
+	    this->drawRange = drawRange;
+	}
 
-    }
+	GLuint Mesh::getMaterialIndex() {
+	    return this->materialIndex;
+	}
 
-	// Initializes all the buffer objects/arrays
-	void Mesh::setupMesh(){
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
+	glm::vec3 Mesh::getBoundsMin() {
+	    return this->boundsMin;
+	}
 
-		glBindVertexArray(this->buffers.VAO);
-		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+	glm::vec3 Mesh::getBoundsMax() {
+	    return this->boundsMax;
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+	/* Mesh drawing function - also applies associated textures */
+	void Mesh::Draw(gps::Shader shader, GLenum indexType)
+	{
+		BindTextures(shader);
+		// the vertex arrays drawn this way have no material index attribute, so its current value is used
+		glVertexAttribI1ui(IndirectDrawBuffer::MATERIAL_INDEX_ATTRIBUTE, this->materialIndex);
 
-		// Set the vertex attribute pointers
-		// Vertex Positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-		// Vertex Normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-		// Vertex Texture Coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		GLsizeiptr indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+		glDrawElementsBaseVertex(GL_TRIANGLES, this->drawRange.indexCount, indexType,
+			(GLvoid*)(this->drawRange.firstIndex * indexSize), this->drawRange.baseVertex);
+    }
 
-		glBindVertexArray(0);
+	void Mesh::BindTextures(gps::Shader shader)
+	{
+		MaterialLibrary::getInstance().bind(shader, this->materialIndex);
 	}
+
 }
@@ -19,12 +19,25 @@ struct Vertex
     glm::vec2 TexCoords;
 };
 
-struct Texture
+// Layout of the vertices in the video memory
+// FULL    - 32 bytes, the Vertex structure as it is
+// COMPACT - 16 bytes, see CompactVertex
+enum VertexFormat { VERTEX_FORMAT_FULL, VERTEX_FORMAT_COMPACT };
+
+struct CompactVertex
 {
-    GLuint id;
-    //ambientTexture, diffuseTexture, specularTexture
-    std::string type;
-    std::string path;
+    // 16 bit unsigned normalized, relative to the bounding box of the model (the 4th component is padding)
+    GLushort Position[4];
+    // signed normalized GL_INT_2_10_10_10_REV
+    GLuint Normal;
+    // two half floats
+    GLuint TexCoords;
+};
+
+// Position stream of the compact layout, 8 bytes: the same quantized values as CompactVertex
+struct CompactPosition
+{
+    GLushort Position[4];
 };
 
 struct Material
@@ -32,12 +45,27 @@ struct Material
         glm::vec3 ambient;
         glm::vec3 diffuse;
         glm::vec3 specular;
+        // specular exponent
+        float shininess;
     };
 
 struct Buffers {
     GLuint VAO;
     GLuint VBO;
     GLuint EBO;
+    // positions only, for the passes which write only depths (same indices)
+    GLuint depthVAO;
+    GLuint positionVBO;
+    // GL_UNSIGNED_SHORT when every vertex of a mesh can be addressed with 16 bits, GL_UNSIGNED_INT otherwise
+    GLenum indexType;
+};
+
+// Part of the shared buffers of a model which belongs to one mesh
+// (the indices of a mesh are relative to its first vertex)
+struct DrawRange {
+    GLint baseVertex;
+    GLuint firstIndex;
+    GLsizei indexCount;
 };
 
 class Mesh
@@ -45,20 +73,31 @@ class Mesh
 public:
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
-    std::vector<Texture> textures;
 
-	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
+	Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, GLuint materialIndex = 0);
+
+	DrawRange getDrawRange();
+	void setDrawRange(DrawRange drawRange);
+
+	// index of the material of the mesh in the MaterialLibrary
+	GLuint getMaterialIndex();
 
-	Buffers getBuffers();
+	// object space bounding box
+	glm::vec3 getBoundsMin();
+	glm::vec3 getBoundsMax();
 
-	void Draw(gps::Shader shader);
+	// Draws the range of the mesh from the buffers bound by the model
+	void Draw(gps::Shader shader, GLenum indexType);
+
+	// Binds the texture arrays of the material of the mesh (they stay bound after drawing)
+	void BindTextures(gps::Shader shader);
 
 private:
     /*  Render data  */
-    Buffers buffers;
-
-	// Initializes all the buffer objects/arrays
-	void setupMesh();
+    DrawRange drawRange;
+    GLuint materialIndex;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
 
 };
 
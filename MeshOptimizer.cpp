@@ -0,0 +1,340 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace gps {
+
+    // parameters of Forsyth's vertex scoring
+    const int FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    // overdraw clusters smaller than this are merged into the previous one
+    const size_t MIN_CLUSTER_TRIANGLES = 8;
+
+    struct VertexHash
+    {
+        size_t operator()(const Vertex& vertex) const {
+            // FNV-1a over the raw bytes of the vertex
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+            size_t hash = 2166136261u;
+            for (size_t i = 0; i < sizeof(Vertex); i++) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    struct VertexEqual
+    {
+        bool operator()(const Vertex& a, const Vertex& b) const {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    static float computeVertexScore(int cachePosition, int remainingTriangles) {
+        if (remainingTriangles == 0) {
+            // no triangle needs this vertex anymore
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // the vertices of the last triangle get a fixed score, to avoid favouring strips
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else {
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+        // boost the vertices with few triangles left, so that they are finished off
+        score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    MeshOptimizationStatistics MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+        MeshOptimizationStatistics statistics;
+        statistics.vertexCountBefore = vertices.size();
+
+        weldVertices(vertices, indices);
+        statistics.before = analyzeVertexCache(indices, vertices.size(), FIFO_CACHE_SIZE);
+
+        optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices);
+        optimizeVertexFetch(vertices, indices);
+
+        statistics.vertexCountAfter = vertices.size();
+        statistics.after = analyzeVertexCache(indices, vertices.size(), FIFO_CACHE_SIZE);
+        return statistics;
+    }
+
+    void MeshOptimizer::weldVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+        std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual> uniqueVertices;
+        std::vector<Vertex> weldedVertices;
+        std::vector<GLuint> remap(vertices.size());
+
+        uniqueVertices.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            std::pair<std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual>::iterator, bool> inserted =
+                uniqueVertices.insert(std::make_pair(vertices[i], (GLuint)weldedVertices.size()));
+            if (inserted.second) {
+                weldedVertices.push_back(vertices[i]);
+            }
+            remap[i] = inserted.first->second;
+        }
+
+        for (size_t i = 0; i < indices.size(); i++) {
+            indices[i] = remap[indices[i]];
+        }
+        vertices.swap(weldedVertices);
+    }
+
+    void MeshOptimizer::optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // triangles adjacent to each vertex; the first remainingTriangles[v] entries are the ones not emitted yet
+        std::vector<int> remainingTriangles(vertexCount, 0);
+        for (size_t i = 0; i < indices.size(); i++) {
+            remainingTriangles[indices[i]]++;
+        }
+        std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+        }
+        std::vector<size_t> adjacency(indices.size());
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[3 * t + k];
+                adjacency[fill[v]++] = t;
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScore[v] = computeVertexScore(-1, remainingTriangles[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        size_t bestTriangle = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+            if (triangleScore[t] > triangleScore[bestTriangle]) {
+                bestTriangle = t;
+            }
+        }
+
+        std::vector<GLuint> optimizedIndices;
+        optimizedIndices.reserve(indices.size());
+        std::vector<GLuint> cache;
+        std::vector<GLuint> newCache;
+        size_t scanCursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (bestTriangle == SIZE_MAX) {
+                // nothing adjacent to the cache is left - continue with the next triangle in the input order
+                while (emitted[scanCursor]) {
+                    scanCursor++;
+                }
+                bestTriangle = scanCursor;
+            }
+
+            size_t triangle = bestTriangle;
+            emitted[triangle] = true;
+            newCache.clear();
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[3 * triangle + k];
+                optimizedIndices.push_back(v);
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+                    newCache.push_back(v);
+                }
+
+                // remove the triangle from the adjacency of the vertex
+                size_t begin = adjacencyOffsets[v];
+                size_t end = begin + remainingTriangles[v];
+                for (size_t a = begin; a < end; a++) {
+                    if (adjacency[a] == triangle) {
+                        std::swap(adjacency[a], adjacency[end - 1]);
+                        break;
+                    }
+                }
+                remainingTriangles[v]--;
+            }
+
+            // the vertices of the new triangle move to the front of the (LRU) cache
+            size_t triangleVertexCount = newCache.size();
+            for (size_t c = 0; c < cache.size(); c++) {
+                GLuint v = cache[c];
+                if (std::find(newCache.begin(), newCache.begin() + triangleVertexCount, v) == newCache.begin() + triangleVertexCount) {
+                    newCache.push_back(v);
+                }
+            }
+
+            // update the scores of the vertices in the cache, including the ones just pushed out of it
+            for (size_t c = 0; c < newCache.size(); c++) {
+                GLuint v = newCache[c];
+                cachePosition[v] = c < (size_t)FORSYTH_CACHE_SIZE ? (int)c : -1;
+                vertexScore[v] = computeVertexScore(cachePosition[v], remainingTriangles[v]);
+            }
+
+            // find the best triangle among the ones touching the cache
+            bestTriangle = SIZE_MAX;
+            float bestScore = -1.0f;
+            for (size_t c = 0; c < newCache.size(); c++) {
+                GLuint v = newCache[c];
+                size_t begin = adjacencyOffsets[v];
+                size_t end = begin + remainingTriangles[v];
+                for (size_t a = begin; a < end; a++) {
+                    size_t t = adjacency[a];
+                    triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            if (newCache.size() > (size_t)FORSYTH_CACHE_SIZE) {
+                newCache.resize(FORSYTH_CACHE_SIZE);
+            }
+            cache.swap(newCache);
+        }
+
+        indices.swap(optimizedIndices);
+    }
+
+    void MeshOptimizer::optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount <= MIN_CLUSTER_TRIANGLES) {
+            return;
+        }
+
+        // split the cache-optimized sequence where the simulated cache has been completely flushed,
+        // so that reordering the clusters keeps (almost) the same vertex cache efficiency
+        std::vector<size_t> clusterStarts(1, 0);
+        std::vector<long long> cacheTimestamp(vertices.size(), LLONG_MIN / 2);
+        long long time = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            int misses = 0;
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[3 * t + k];
+                if (time - cacheTimestamp[v] >= FIFO_CACHE_SIZE) {
+                    cacheTimestamp[v] = time++;
+                    misses++;
+                }
+            }
+            if (misses == 3 && t - clusterStarts.back() >= MIN_CLUSTER_TRIANGLES) {
+                clusterStarts.push_back(t);
+            }
+        }
+        if (clusterStarts.size() < 2) {
+            return;
+        }
+        clusterStarts.push_back(triangleCount);
+
+        // area weighted centroid of the whole mesh
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t t = 0; t < triangleCount; t++) {
+            const glm::vec3& p0 = vertices[indices[3 * t]].Position;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].Position;
+            float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+            meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+            meshArea += area;
+        }
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        // clusters facing away from the center of the mesh are likely to occlude the others - draw them first
+        size_t clusterCount = clusterStarts.size() - 1;
+        std::vector<std::pair<float, size_t> > clusterOrder(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++) {
+            glm::vec3 clusterCentroid(0.0f);
+            glm::vec3 clusterNormal(0.0f);
+            float clusterArea = 0.0f;
+            for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+                const glm::vec3& p0 = vertices[indices[3 * t]].Position;
+                const glm::vec3& p1 = vertices[indices[3 * t + 1]].Position;
+                const glm::vec3& p2 = vertices[indices[3 * t + 2]].Position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                clusterCentroid += (p0 + p1 + p2) * (area / 3.0f);
+                clusterNormal += normal;
+                clusterArea += area;
+            }
+
+            float outwardness = 0.0f;
+            float normalLength = glm::length(clusterNormal);
+            if (clusterArea > 0.0f && normalLength > 0.0f) {
+                clusterCentroid /= clusterArea;
+                outwardness = glm::dot(clusterCentroid - meshCentroid, clusterNormal / normalLength);
+            }
+            clusterOrder[c] = std::make_pair(-outwardness, c);
+        }
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end());
+
+        std::vector<GLuint> sortedIndices;
+        sortedIndices.reserve(indices.size());
+        for (size_t i = 0; i < clusterCount; i++) {
+            size_t c = clusterOrder[i].second;
+            sortedIndices.insert(sortedIndices.end(), indices.begin() + 3 * clusterStarts[c], indices.begin() + 3 * clusterStarts[c + 1]);
+        }
+        indices.swap(sortedIndices);
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices) {
+        std::vector<GLuint> remap(vertices.size(), UINT_MAX);
+        std::vector<Vertex> orderedVertices;
+        orderedVertices.reserve(vertices.size());
+
+        for (size_t i = 0; i < indices.size(); i++) {
+            GLuint v = indices[i];
+            if (remap[v] == UINT_MAX) {
+                remap[v] = (GLuint)orderedVertices.size();
+                orderedVertices.push_back(vertices[v]);
+            }
+            indices[i] = remap[v];
+        }
+        vertices.swap(orderedVertices);
+    }
+
+    VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize) {
+        VertexCacheStatistics statistics;
+        statistics.acmr = 0.0f;
+        statistics.atvr = 0.0f;
+        if (indices.empty() || vertexCount == 0) {
+            return statistics;
+        }
+
+        std::vector<long long> cacheTimestamp(vertexCount, LLONG_MIN / 2);
+        long long time = 0;
+        for (size_t i = 0; i < indices.size(); i++) {
+            GLuint v = indices[i];
+            if (time - cacheTimestamp[v] >= cacheSize) {
+                cacheTimestamp[v] = time++;
+            }
+        }
+
+        // every increment of the time is a transformed vertex
+        statistics.acmr = (float)time / (indices.size() / 3);
+        statistics.atvr = (float)time / vertexCount;
+        return statistics;
+    }
+
+}
@@ -0,0 +1,56 @@
+#ifndef MeshOptimizer_hpp
+#define MeshOptimizer_hpp
+
+#include "Mesh.hpp"
+
+#include <vector>
+
+namespace gps {
+
+// Post-transform vertex cache efficiency of an index buffer
+// ACMR - average cache miss ratio, transformed vertices per triangle (0.5 is ideal, 3.0 is the worst)
+// ATVR - average transformed vertex ratio, transformed vertices per unique vertex (1.0 is ideal)
+struct VertexCacheStatistics
+{
+    float acmr;
+    float atvr;
+};
+
+struct MeshOptimizationStatistics
+{
+    size_t vertexCountBefore;
+    size_t vertexCountAfter;
+    // measured on the welded mesh in the original triangle order
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+};
+
+// Reorders the triangles and vertices of a mesh for faster rendering, without changing what is drawn
+class MeshOptimizer
+{
+public:
+    // size of the simulated FIFO cache used for the statistics and the overdraw clustering
+    static const int FIFO_CACHE_SIZE = 16;
+
+    // Runs all the optimizations below, in order
+    static MeshOptimizationStatistics optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+    // Merges the identical vertices and rewrites the indices accordingly
+    static void weldVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+    // Reorders the triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+    static void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount);
+
+    // Reorders the cache-friendly clusters of triangles so that the outer surfaces are drawn first (Tipsify-like)
+    static void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices);
+
+    // Reorders the vertices in the order they are first referenced by the indices, dropping the unused ones
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+    // Simulates a FIFO post-transform cache of the given size
+    static VertexCacheStatistics analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize);
+};
+
+}
+
+#endif /* MeshOptimizer_hpp */
@@ -1,23 +1,100 @@
 #include "Model3D.hpp"
+#include "GLStateCache.hpp"
+#include "MeshOptimizer.hpp"
+
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
 
 namespace gps {
 
-	void Model3D::LoadModel(std::string fileName)
+	Model3D::Model3D() {
+		buffers.VAO = 0;
+		buffers.VBO = 0;
+		buffers.EBO = 0;
+		buffers.depthVAO = 0;
+		buffers.positionVBO = 0;
+		buffers.indexType = GL_UNSIGNED_INT;
+		vertexFormat = VERTEX_FORMAT_FULL;
+		positionScale = glm::vec3(1.0f);
+		positionOffset = glm::vec3(0.0f);
+	}
+
+	void Model3D::LoadModel(std::string fileName, VertexFormat format)
 	{
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
 		ReadOBJ(fileName, basePath);
+		SetupBuffers(format);
 	}
 
-    void Model3D::LoadModel(std::string fileName, std::string basePath)
+    void Model3D::LoadModel(std::string fileName, std::string basePath, VertexFormat format)
 	{
 		ReadOBJ(fileName, basePath);
+		SetupBuffers(format);
 	}
 
 	// Draw each mesh from the model
 	void Model3D::Draw(gps::Shader shaderProgram)
 	{
+		shaderProgram.useShaderProgram();
+
+		// identity for full float vertices
+		glUniform3fv(glGetUniformLocation(shaderProgram.shaderProgram, "positionScale"), 1, glm::value_ptr(positionScale));
+		glUniform3fv(glGetUniformLocation(shaderProgram.shaderProgram, "positionOffset"), 1, glm::value_ptr(positionOffset));
+
+		GLStateCache::getInstance().bindVertexArray(buffers.VAO);
 		for (int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shaderProgram);
+			meshes[i].Draw(shaderProgram, buffers.indexType);
+	}
+
+	void Model3D::Enqueue(RenderQueue& queue, RenderPass pass, gps::Shader shaderProgram, glm::mat4 model, glm::mat3 normalMatrix, glm::mat4 clipTransformation)
+	{
+		if (buffers.VAO == 0) {
+			return;
+		}
+
+		RenderObject object;
+		object.model = model;
+		object.normalMatrix = normalMatrix;
+		object.positionScale = positionScale;
+		object.positionOffset = positionOffset;
+		// the depth passes fetch only the positions
+		object.vertexArray = RenderQueue::isDepthOnly(pass) ? buffers.depthVAO : buffers.VAO;
+		object.indexType = buffers.indexType;
+		size_t objectIndex = queue.addObject(object);
+
+		Frustum frustum(clipTransformation);
+		for (size_t i = 0; i < meshes.size(); i++) {
+			Mesh& mesh = meshes[i];
+			if (!frustum.intersectsBox(mesh.getBoundsMin(), mesh.getBoundsMax())) {
+				continue;
+			}
+			// depth of the center of the bounding box, in [0, 1]
+			glm::vec4 center = clipTransformation * glm::vec4(0.5f * (mesh.getBoundsMin() + mesh.getBoundsMax()), 1.0f);
+			float depth = center.w > 0.0f ? 0.5f * center.z / center.w + 0.5f : 0.0f;
+			queue.addItem(pass, shaderProgram, objectIndex, &mesh, depth);
+		}
+	}
+
+	Buffers Model3D::getBuffers() {
+		return buffers;
+	}
+
+	void Model3D::getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) {
+		boundsMin = glm::vec3(0.0f);
+		boundsMax = glm::vec3(0.0f);
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (i == 0) {
+				boundsMin = meshes[i].getBoundsMin();
+				boundsMax = meshes[i].getBoundsMax();
+				continue;
+			}
+			boundsMin = glm::min(boundsMin, meshes[i].getBoundsMin());
+			boundsMax = glm::max(boundsMax, meshes[i].getBoundsMax());
+		}
 	}
 
 	// Does the parsing of the .obj file and fills in the data structure
@@ -27,7 +104,8 @@ namespace gps {
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
-		int materialId;
+		// index in the material library of the materials of the file
+		std::map<int, GLuint> libraryMaterials;
 
 		std::string err;
 		bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, fileName.c_str(), basePath.c_str(), GL_TRUE);
@@ -47,16 +125,13 @@ namespace gps {
 		for (size_t s = 0; s < shapes.size(); s++) {
 			std::vector<gps::Vertex> vertices;
 			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+			int materialId = -1;
 
 			// Loop over faces(polygon)
 			size_t index_offset = 0;
 			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
 				int fv = shapes[s].mesh.num_face_vertices[f];
 
-				//gps::Texture currentTexture = LoadTexture("index1.png", "ambientTexture");
-				//textures.push_back(currentTexture);
-
 				// Loop over vertices in the face.
 				for (size_t v = 0; v < fv; v++) {
 					// access to vertex
@@ -97,137 +172,189 @@ namespace gps {
 			int a = shapes[s].mesh.material_ids.size();
 			if (a > 0 && materials.size()>0) {
 				materialId = shapes[s].mesh.material_ids[0];
-				if (materialId != -1) {
+				if (materialId != -1 && libraryMaterials.count(materialId) == 0) {
 					gps::Material currentMaterial;
 					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
 					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
 					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
+					currentMaterial.shininess = materials[materialId].shininess;
 
-					//ambient texture
-					std::string ambientTexturePath = materials[materialId].ambient_texname;
-					if (!ambientTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
+					// the textures are loaded into texture arrays once all the models are read
+					std::string texturePaths[TEXTURE_SLOT_COUNT];
+					if (!materials[materialId].ambient_texname.empty()) {
+						texturePaths[AMBIENT_TEXTURE] = basePath + materials[materialId].ambient_texname;
 					}
-
-					//diffuse texture
-					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
-					if (!diffuseTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
+					if (!materials[materialId].diffuse_texname.empty()) {
+						texturePaths[DIFFUSE_TEXTURE] = basePath + materials[materialId].diffuse_texname;
 					}
-
-					//specular texture
-					std::string specularTexturePath = materials[materialId].specular_texname;
-					if (!specularTexturePath.empty())
-					{
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
+					if (!materials[materialId].specular_texname.empty()) {
+						texturePaths[SPECULAR_TEXTURE] = basePath + materials[materialId].specular_texname;
 					}
+					libraryMaterials[materialId] = MaterialLibrary::getInstance().addMaterial(currentMaterial, texturePaths);
 				}
 			}
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+			// the faces come in file order, with a separate vertex for every corner
+			MeshOptimizationStatistics statistics = MeshOptimizer::optimize(vertices, indices);
+			std::cout << "  mesh " << s << ": " << statistics.vertexCountBefore << " -> " << statistics.vertexCountAfter << " vertices"
+				<< ", ACMR " << statistics.before.acmr << " -> " << statistics.after.acmr
+				<< ", ATVR " << statistics.before.atvr << " -> " << statistics.after.atvr << std::endl;
+
+			meshes.push_back(gps::Mesh(vertices, indices, materialId != -1 ? libraryMaterials[materialId] : 0));
 		}
 	}
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
+	// Packs the meshes into one vertex and one index buffer
+	void Model3D::SetupBuffers(VertexFormat format) {
+		vertexFormat = format;
+		positionScale = glm::vec3(1.0f);
+		positionOffset = glm::vec3(0.0f);
+
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		size_t largestMesh = 0;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			DrawRange drawRange;
+			drawRange.baseVertex = (GLint)vertices.size();
+			drawRange.firstIndex = (GLuint)indices.size();
+			drawRange.indexCount = (GLsizei)meshes[i].indices.size();
+			meshes[i].setDrawRange(drawRange);
+
+			vertices.insert(vertices.end(), meshes[i].vertices.begin(), meshes[i].vertices.end());
+			indices.insert(indices.end(), meshes[i].indices.begin(), meshes[i].indices.end());
+			largestMesh = std::max(largestMesh, meshes[i].vertices.size());
+		}
+		if (vertices.empty() || indices.empty()) {
+			return;
+		}
 
-			for (int i = 0; i < loadedTextures.size(); i++) {
-				if (loadedTextures[i].path == path)
-				{
-					//already loaded texture
-					return loadedTextures[i];
-				}
+		// Create buffers/arrays
+		glGenVertexArrays(1, &buffers.VAO);
+		glGenBuffers(1, &buffers.VBO);
+		glGenBuffers(1, &buffers.EBO);
+
+		GLStateCache::getInstance().bindVertexArray(buffers.VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+		if (largestMesh <= 65536) {
+			// the indices are relative to the base vertex of each mesh - half of the index bandwidth
+			std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), &shortIndices[0], GL_STATIC_DRAW);
+			buffers.indexType = GL_UNSIGNED_SHORT;
+		}
+		else {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+			buffers.indexType = GL_UNSIGNED_INT;
+		}
+
+		// Load data into vertex buffers and set the vertex attribute pointers
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+		std::vector<CompactVertex> compactVertices;
+		if (format == VERTEX_FORMAT_COMPACT) {
+			compactVertices = CompressVertices(vertices);
+			glBufferData(GL_ARRAY_BUFFER, compactVertices.size() * sizeof(CompactVertex), &compactVertices[0], GL_STATIC_DRAW);
+
+			// Vertex Positions
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, Position));
+			// Vertex Normals
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, Normal));
+			// Vertex Texture Coords
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (GLvoid*)offsetof(CompactVertex, TexCoords));
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+
+			// Vertex Positions
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+			// Vertex Normals
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+			// Vertex Texture Coords
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		}
+
+		// Tightly packed positions for the shadow and depth pre-pass: 8 instead of 16 bytes per vertex
+		// (12 instead of 32 for full vertices), the values are the same so both streams give the same depths
+		glGenVertexArrays(1, &buffers.depthVAO);
+		glGenBuffers(1, &buffers.positionVBO);
+
+		GLStateCache::getInstance().bindVertexArray(buffers.depthVAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.positionVBO);
+		if (format == VERTEX_FORMAT_COMPACT) {
+			std::vector<CompactPosition> positions(compactVertices.size());
+			for (size_t i = 0; i < compactVertices.size(); i++) {
+				std::copy(compactVertices[i].Position, compactVertices[i].Position + 4, positions[i].Position);
 			}
+			glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(CompactPosition), &positions[0], GL_STATIC_DRAW);
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
-
-			loadedTextures.push_back(currentTexture);
-
-			return currentTexture;
-		}
-
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
-		int x, y, n;
-		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
-		if (!image_data) {
-			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
-		}
-		// NPOT check
-		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
-			fprintf(
-				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
-			);
-		}
-
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
-
-		for (int row = 0; row < half_height; row++) {
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
-			for (int col = 0; col < width_in_bytes; col++) {
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactPosition), (GLvoid*)0);
+		}
+		else {
+			std::vector<glm::vec3> positions(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++) {
+				positions[i] = vertices[i].Position;
 			}
+			glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
 		}
 
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			image_data
-		);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		return textureID;
+		GLStateCache::getInstance().bindVertexArray(0);
+	}
+
+	// Quantizes the vertices into the compact layout, relative to the bounding box of the model
+	std::vector<CompactVertex> Model3D::CompressVertices(const std::vector<Vertex>& vertices) {
+		glm::vec3 boundsMin = vertices[0].Position;
+		glm::vec3 boundsMax = vertices[0].Position;
+		for (size_t i = 1; i < vertices.size(); i++) {
+			boundsMin = glm::min(boundsMin, vertices[i].Position);
+			boundsMax = glm::max(boundsMax, vertices[i].Position);
+		}
+
+		positionOffset = boundsMin;
+		positionScale = boundsMax - boundsMin;
+		for (int axis = 0; axis < 3; axis++) {
+			// flat models - any scale works on that axis
+			if (positionScale[axis] <= 0.0f) {
+				positionScale[axis] = 1.0f;
+			}
+		}
+
+		std::vector<CompactVertex> compactVertices(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			const Vertex& vertex = vertices[i];
+			CompactVertex& compactVertex = compactVertices[i];
+
+			glm::vec3 position = (vertex.Position - positionOffset) / positionScale;
+			for (int axis = 0; axis < 3; axis++) {
+				compactVertex.Position[axis] = (GLushort)std::round(std::min(std::max(position[axis], 0.0f), 1.0f) * 65535.0f);
+			}
+			compactVertex.Position[3] = 0;
+
+			GLuint normal = 0;
+			for (int axis = 0; axis < 3; axis++) {
+				int component = (int)std::round(std::min(std::max(vertex.Normal[axis], -1.0f), 1.0f) * 511.0f);
+				normal |= ((GLuint)component & 0x3FF) << (10 * axis);
+			}
+			compactVertex.Normal = normal;
+
+			compactVertex.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+		}
+		return compactVertices;
 	}
 
 	Model3D::~Model3D() {
-        for (size_t i = 0; i < loadedTextures.size(); i++) {
-            glDeleteTextures(1, &loadedTextures.at(i).id);
-        }
-
-        for (size_t i = 0; i < meshes.size(); i++) {
-            GLuint VBO = meshes.at(i).getBuffers().VBO;
-            GLuint EBO = meshes.at(i).getBuffers().EBO;
-            GLuint VAO = meshes.at(i).getBuffers().VAO;
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
-        }
+        glDeleteBuffers(1, &buffers.VBO);
+        glDeleteBuffers(1, &buffers.EBO);
+        glDeleteVertexArrays(1, &buffers.VAO);
+        glDeleteBuffers(1, &buffers.positionVBO);
+        glDeleteVertexArrays(1, &buffers.depthVAO);
 	}
 }
@@ -1,7 +1,10 @@
 #ifndef Model3D_hpp
 #define Model3D_hpp
 
+#include "Frustum.hpp"
+#include "MaterialLibrary.hpp"
 #include "Mesh.hpp"
+#include "RenderQueue.hpp"
 
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
@@ -16,28 +19,43 @@ namespace gps {
     {
 
     public:
+        Model3D();
         ~Model3D();
 
-		void LoadModel(std::string fileName);
+		void LoadModel(std::string fileName, VertexFormat format = VERTEX_FORMAT_FULL);
 
-		void LoadModel(std::string fileName, std::string basePath);
+		void LoadModel(std::string fileName, std::string basePath, VertexFormat format = VERTEX_FORMAT_FULL);
 
 		void Draw(gps::Shader shaderProgram);
 
+		// Adds the meshes inside the view frustum to the render queue
+		// clipTransformation - projection * view * model matrix, used for the culling and the depth sorting
+		void Enqueue(RenderQueue& queue, RenderPass pass, gps::Shader shaderProgram, glm::mat4 model, glm::mat3 normalMatrix, glm::mat4 clipTransformation);
+
+		Buffers getBuffers();
+
+		// object space bounding box of all the meshes
+		void getBounds(glm::vec3& boundsMin, glm::vec3& boundsMax);
+
     private:
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
-		// Associated textures
-        std::vector<gps::Texture> loadedTextures;
+
+		// Vertices and indices of all the meshes, each mesh drawing its own range
+		Buffers buffers;
+		VertexFormat vertexFormat;
+		// maps the quantized positions back to object space: position = positionOffset + positionScale * quantized
+		glm::vec3 positionScale;
+		glm::vec3 positionOffset;
 
 		// Does the parsing of the .obj file and fills in the data structure
 		void ReadOBJ(std::string fileName, std::string basePath);
 
-		// Retrieves a texture associated with the object - by its name and type
-		gps::Texture LoadTexture(std::string path, std::string type);
+		// Packs the meshes into one vertex and one index buffer
+		void SetupBuffers(VertexFormat format);
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		// Quantizes the vertices into the compact layout, relative to the bounding box of the model
+		std::vector<CompactVertex> CompressVertices(const std::vector<Vertex>& vertices);
     };
 }
 
@@ -0,0 +1,173 @@
+#include "ProgramBinaryCache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace gps {
+
+    // identifies the files written by this class (and their layout version)
+    static const uint32_t CACHE_FILE_MAGIC = 0x31425047; // "GPB1"
+
+    // 64 bit FNV-1a
+    static uint64_t hashString(const std::string& text, uint64_t hash) {
+        for (size_t i = 0; i < text.size(); i++) {
+            hash ^= (unsigned char)text[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    ProgramBinaryCache& ProgramBinaryCache::getInstance() {
+        static ProgramBinaryCache instance;
+        return instance;
+    }
+
+    ProgramBinaryCache::ProgramBinaryCache() {
+        this->directory = "shader_cache";
+        // not known before there is a context
+        this->supportedState = -1;
+        this->hitCount = 0;
+        this->missCount = 0;
+        this->hitMilliseconds = 0.0;
+        this->missMilliseconds = 0.0;
+    }
+
+    void ProgramBinaryCache::setDirectory(std::string directory) {
+        this->directory = directory;
+    }
+
+    bool ProgramBinaryCache::isSupported() {
+        if (supportedState < 0) {
+            GLint formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            supportedState = formatCount > 0 ? 1 : 0;
+        }
+        return supportedState == 1;
+    }
+
+    std::string ProgramBinaryCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource) {
+        uint64_t hash = 14695981039346656037ULL;
+        hash = hashString(vertexSource, hash);
+        // separates the sources, "ab" + "c" and "a" + "bc" are different programs
+        hash = hashString(std::string(1, '\0'), hash);
+        hash = hashString(fragmentSource, hash);
+        hash = hashString(getDriverString(), hash);
+
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+        return std::string(key);
+    }
+
+    bool ProgramBinaryCache::load(const std::string& key, GLuint program) {
+        if (!isSupported()) {
+            return false;
+        }
+        std::ifstream file(getPath(key).c_str(), std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        uint32_t magic = 0;
+        uint32_t driverLength = 0;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&driverLength, sizeof(driverLength));
+        if (!file || magic != CACHE_FILE_MAGIC || driverLength > 4096) {
+            return false;
+        }
+        // the hash could collide - the driver string must match exactly
+        std::string driver(driverLength, '\0');
+        file.read(&driver[0], driverLength);
+        if (!file || driver != getDriverString()) {
+            return false;
+        }
+
+        GLenum binaryFormat = 0;
+        uint32_t binaryLength = 0;
+        file.read((char*)&binaryFormat, sizeof(binaryFormat));
+        file.read((char*)&binaryLength, sizeof(binaryLength));
+        if (!file || binaryLength == 0) {
+            return false;
+        }
+        std::vector<char> binary(binaryLength);
+        file.read(&binary[0], binaryLength);
+        if (!file) {
+            return false;
+        }
+
+        glProgramBinary(program, binaryFormat, &binary[0], (GLsizei)binaryLength);
+        // the driver may still reject a binary it wrote itself (e.g. after a partial update)
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success == GL_TRUE;
+    }
+
+    void ProgramBinaryCache::store(const std::string& key, GLuint program) {
+        if (!isSupported()) {
+            return;
+        }
+        GLint binaryLength = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength <= 0) {
+            return;
+        }
+        std::vector<char> binary(binaryLength);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, binaryLength, NULL, &binaryFormat, &binary[0]);
+
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        std::ofstream file(getPath(key).c_str(), std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "WARNING: could not write the shader cache " << getPath(key) << std::endl;
+            return;
+        }
+
+        std::string driver = getDriverString();
+        uint32_t driverLength = (uint32_t)driver.size();
+        uint32_t length = (uint32_t)binaryLength;
+        file.write((const char*)&CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+        file.write((const char*)&driverLength, sizeof(driverLength));
+        file.write(driver.c_str(), driverLength);
+        file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+        file.write((const char*)&length, sizeof(length));
+        file.write(&binary[0], binaryLength);
+    }
+
+    void ProgramBinaryCache::printStats(std::ostream& out) {
+        out << "Shader programs: " << hitCount << " from the cache (" << hitMilliseconds << " ms), "
+            << missCount << " compiled (" << missMilliseconds << " ms)" << std::endl;
+    }
+
+    void ProgramBinaryCache::addLoadTime(bool hit, double milliseconds) {
+        if (hit) {
+            hitCount++;
+            hitMilliseconds += milliseconds;
+        }
+        else {
+            missCount++;
+            missMilliseconds += milliseconds;
+        }
+    }
+
+    std::string ProgramBinaryCache::getDriverString() {
+        std::stringstream driver;
+        driver << glGetString(GL_VENDOR) << "|" << glGetString(GL_RENDERER) << "|" << glGetString(GL_VERSION);
+        return driver.str();
+    }
+
+    std::string ProgramBinaryCache::getPath(const std::string& key) {
+        return directory + "/" + key + ".bin";
+    }
+
+}
@@ -0,0 +1,52 @@
+#ifndef ProgramBinaryCache_hpp
+#define ProgramBinaryCache_hpp
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace gps {
+
+// Keeps the linked shader programs on disk (glGetProgramBinary), so the next launches can skip
+// compiling and linking. An entry is identified by the hash of the sources and of the driver
+// (vendor, renderer, version), so a changed shader or a driver update just misses the cache.
+class ProgramBinaryCache
+{
+public:
+    static ProgramBinaryCache& getInstance();
+
+    void setDirectory(std::string directory);
+    // false when the driver supports no binary formats
+    bool isSupported();
+
+    // identifies the program built from the given sources on the current driver
+    std::string makeKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // loads the binary of the program into the (new) program object, false if it is missing or rejected
+    bool load(const std::string& key, GLuint program);
+    // saves the binary of the linked program (linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    void store(const std::string& key, GLuint program);
+
+    // hits and misses since the start, with the time spent on each
+    void printStats(std::ostream& out);
+    void addLoadTime(bool hit, double milliseconds);
+
+private:
+    ProgramBinaryCache();
+
+    std::string getDriverString();
+    std::string getPath(const std::string& key);
+
+    std::string directory;
+    int supportedState;
+    int hitCount;
+    int missCount;
+    double hitMilliseconds;
+    double missMilliseconds;
+};
+
+}
+
+#endif /* ProgramBinaryCache_hpp */
@@ -0,0 +1,130 @@
+#include "RenderQueue.hpp"
+#include "MaterialLibrary.hpp"
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gps {
+
+    static bool compareSortKeys(const RenderItem& first, const RenderItem& second) {
+        return first.sortKey < second.sortKey;
+    }
+
+    uint64_t RenderQueue::makeSortKey(RenderPass pass, GLuint shaderProgram, GLuint material, float depth) {
+        // non-negative floats keep their order when their bits are compared as integers
+        depth = std::min(std::max(depth, 0.0f), 1.0f);
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+        return ((uint64_t)(pass & 0xF) << 60)
+            | ((uint64_t)(shaderProgram & 0xFFF) << 48)
+            | ((uint64_t)(material & 0xFFFF) << 32)
+            | (uint64_t)depthBits;
+    }
+
+    bool RenderQueue::isDepthOnly(RenderPass pass) {
+        return pass == RENDER_PASS_SHADOW || pass == RENDER_PASS_DEPTH_PREPASS;
+    }
+
+    size_t RenderQueue::addObject(const RenderObject& object) {
+        objects.push_back(object);
+        return objects.size() - 1;
+    }
+
+    void RenderQueue::addItem(RenderPass pass, gps::Shader shader, size_t objectIndex, Mesh* mesh, float depth) {
+        // materials with their textures in the same arrays are drawn together
+        GLuint material = isDepthOnly(pass) ? 0 : MaterialLibrary::getInstance().getBindingKey(mesh->getMaterialIndex());
+
+        RenderItem item;
+        item.sortKey = makeSortKey(pass, shader.shaderProgram, material, depth);
+        item.pass = pass;
+        item.shaderProgram = shader.shaderProgram;
+        item.objectIndex = objectIndex;
+        item.mesh = mesh;
+        items.push_back(item);
+    }
+
+    void RenderQueue::submit(IndirectDrawBuffer& drawBuffer) {
+        lastItemCount = items.size();
+        lastBatchCount = 0;
+        if (items.empty()) {
+            objects.clear();
+            return;
+        }
+
+        std::stable_sort(items.begin(), items.end(), compareSortKeys);
+
+        // the commands are added in the sorted order, so every batch is a range of consecutive commands
+        size_t firstCommand = drawBuffer.getCommandCount();
+        for (size_t i = 0; i < items.size(); i++) {
+            drawBuffer.attachToVertexArray(objects[items[i].objectIndex].vertexArray);
+            drawBuffer.addCommand(items[i].mesh->getDrawRange(), items[i].mesh->getMaterialIndex());
+        }
+        drawBuffer.upload();
+
+        size_t batchStart = 0;
+        for (size_t i = 1; i <= items.size(); i++) {
+            if (i < items.size() && isSameState(items[batchStart], items[i])) {
+                continue;
+            }
+            applyState(items[batchStart], batchStart > 0 ? &items[batchStart - 1] : NULL);
+            drawBuffer.submit(firstCommand + batchStart, i - batchStart, objects[items[batchStart].objectIndex].indexType);
+            lastBatchCount++;
+            batchStart = i;
+        }
+
+        items.clear();
+        objects.clear();
+    }
+
+    size_t RenderQueue::getItemCount() {
+        return lastItemCount;
+    }
+
+    int RenderQueue::getBatchCount() {
+        return lastBatchCount;
+    }
+
+    void RenderQueue::printStats(std::ostream& out) {
+        out << "Render queue: " << lastItemCount << " item(s) in " << lastBatchCount << " batch(es)" << std::endl;
+    }
+
+    bool RenderQueue::isSameState(const RenderItem& first, const RenderItem& second) {
+        if (first.shaderProgram != second.shaderProgram || first.objectIndex != second.objectIndex) {
+            return false;
+        }
+        if (isDepthOnly(first.pass) && isDepthOnly(second.pass)) {
+            return true;
+        }
+        // the material index itself is a per draw attribute
+        MaterialLibrary& materialLibrary = MaterialLibrary::getInstance();
+        return materialLibrary.getBindingKey(first.mesh->getMaterialIndex()) == materialLibrary.getBindingKey(second.mesh->getMaterialIndex());
+    }
+
+    // Sets the program, the per object uniforms and the textures of the item,
+    // skipping what is already set by the previous item
+    void RenderQueue::applyState(const RenderItem& item, const RenderItem* previous) {
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        const RenderObject& object = objects[item.objectIndex];
+
+        gps::Shader shader;
+        shader.shaderProgram = item.shaderProgram;
+        stateCache.useProgram(item.shaderProgram);
+
+        bool sameObject = previous != NULL && previous->shaderProgram == item.shaderProgram && previous->objectIndex == item.objectIndex;
+        if (!sameObject) {
+            glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(object.model));
+            glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(object.normalMatrix));
+            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "positionScale"), 1, glm::value_ptr(object.positionScale));
+            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "positionOffset"), 1, glm::value_ptr(object.positionOffset));
+        }
+        stateCache.bindVertexArray(object.vertexArray);
+
+        if (!isDepthOnly(item.pass)) {
+            item.mesh->BindTextures(shader);
+        }
+    }
+
+}
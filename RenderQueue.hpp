@@ -0,0 +1,82 @@
+#ifndef RenderQueue_hpp
+#define RenderQueue_hpp
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include "GLStateCache.hpp"
+#include "IndirectDrawBuffer.hpp"
+#include "Mesh.hpp"
+#include "Shader.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace gps {
+
+// Passes in their order of submission; the shadow and depth pre-pass only write depths
+enum RenderPass { RENDER_PASS_SHADOW = 0, RENDER_PASS_DEPTH_PREPASS = 1, RENDER_PASS_OPAQUE = 2 };
+
+// Data shared by all the draw items of one model instance
+struct RenderObject
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    // dequantization of the vertex positions of the model
+    glm::vec3 positionScale;
+    glm::vec3 positionOffset;
+    GLuint vertexArray;
+    GLenum indexType;
+};
+
+// One mesh to draw
+struct RenderItem
+{
+    uint64_t sortKey;
+    RenderPass pass;
+    GLuint shaderProgram;
+    size_t objectIndex;
+    Mesh* mesh;
+};
+
+// Collects the draws of a frame, sorts them to minimize the state changes and submits them.
+// The sort key, from the most significant bits:
+//   pass (4 bits) | shader program (12 bits) | material (16 bits) | depth (32 bits, front to back)
+// The passes writing only depths do not use the materials, their items are only sorted front to back.
+// Consecutive items that share the program, object and texture arrays are drawn with one multi-draw.
+class RenderQueue
+{
+public:
+    // the passes which write only depths, drawn without materials from the position-only vertex arrays
+    static bool isDepthOnly(RenderPass pass);
+
+    static uint64_t makeSortKey(RenderPass pass, GLuint shaderProgram, GLuint material, float depth);
+
+    // returns the index of the object, to be used by its items
+    size_t addObject(const RenderObject& object);
+    // depth - normalized device depth of the mesh, in [0, 1]
+    void addItem(RenderPass pass, gps::Shader shader, size_t objectIndex, Mesh* mesh, float depth);
+
+    // sorts and draws all the items, then empties the queue
+    void submit(IndirectDrawBuffer& drawBuffer);
+
+    size_t getItemCount();
+    // multi-draws issued by the last submission
+    int getBatchCount();
+    void printStats(std::ostream& out);
+
+private:
+    // true if the two items can be drawn with the same state
+    bool isSameState(const RenderItem& first, const RenderItem& second);
+    void applyState(const RenderItem& item, const RenderItem* previous);
+
+    std::vector<RenderObject> objects;
+    std::vector<RenderItem> items;
+    size_t lastItemCount;
+    int lastBatchCount;
+};
+
+}
+
+#endif /* RenderQueue_hpp */
@@ -0,0 +1,31 @@
+#include "ScreenTriangle.hpp"
+#include "GLStateCache.hpp"
+
+namespace gps {
+
+    ScreenTriangle& ScreenTriangle::getInstance() {
+        static ScreenTriangle instance;
+        return instance;
+    }
+
+    ScreenTriangle::ScreenTriangle() {
+        this->vertexArray = 0;
+    }
+
+    void ScreenTriangle::draw() {
+        if (vertexArray == 0) {
+            glGenVertexArrays(1, &vertexArray);
+        }
+        GLStateCache::getInstance().bindVertexArray(vertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    void ScreenTriangle::destroy() {
+        if (vertexArray != 0) {
+            GLStateCache::getInstance().bindVertexArray(0);
+            glDeleteVertexArrays(1, &vertexArray);
+        }
+        vertexArray = 0;
+    }
+
+}
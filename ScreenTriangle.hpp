@@ -0,0 +1,28 @@
+#ifndef ScreenTriangle_hpp
+#define ScreenTriangle_hpp
+
+#include <GL/glew.h>
+
+namespace gps {
+
+// Draws one triangle covering the viewport, for the full screen passes (deferred lighting, upscale).
+// It has no vertex attributes, shaders/screenTriangle.vert generates the vertices from gl_VertexID;
+// the empty vertex array a core profile draw needs is created on the first draw.
+class ScreenTriangle
+{
+public:
+    static ScreenTriangle& getInstance();
+
+    // with the current program and framebuffer
+    void draw();
+    void destroy();
+
+private:
+    ScreenTriangle();
+
+    GLuint vertexArray;
+};
+
+}
+
+#endif /* ScreenTriangle_hpp */
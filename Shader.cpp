@@ -1,28 +1,15 @@
 #include "Shader.hpp"
+#include "GLStateCache.hpp"
+#include "ProgramBinaryCache.hpp"
 
 namespace gps {
-    std::string Shader::readShaderFile(std::string fileName)
+    std::string Shader::readShaderFile(std::string fileName, std::vector<std::string>& sourceFiles)
     {
-        std::ifstream shaderFile;
-        std::string shaderString;
-
-        //open shader file
-        shaderFile.open(fileName.c_str());
-
-        std::stringstream shaderStringStream;
-
-        //read shader content into stream
-        shaderStringStream << shaderFile.rdbuf();
-
-        //close shader file
-        shaderFile.close();
-
-        //convert stream into GLchar array
-        shaderString = shaderStringStream.str();
-        return shaderString;
+        //read the shader and the files it includes, with the defines of the permutation
+        return ShaderPreprocessor::process(fileName, this->defines, sourceFiles);
     }
 
-    void Shader::shaderCompileLog(GLuint shaderId)
+    void Shader::shaderCompileLog(GLuint shaderId, const std::vector<std::string>& sourceFiles)
     {
         GLint success;
         GLchar infoLog[512];
@@ -33,10 +20,14 @@ namespace gps {
         {
             glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
             std::cout << "Shader compilation error\n" << infoLog << std::endl;
+            //the errors are reported as source number(line)
+            for (size_t i = 0; i < sourceFiles.size(); i++) {
+                std::cout << "  " << i << ": " << sourceFiles[i] << std::endl;
+            }
         }
     }
 
-    void Shader::shaderLinkLog(GLuint shaderProgramId)
+    bool Shader::shaderLinkLog(GLuint shaderProgramId)
     {
         GLint success;
         GLchar infoLog[512];
@@ -47,44 +38,127 @@ namespace gps {
             glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
+        return success == GL_TRUE;
     }
 
-    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName)
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines)
     {
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
+        beginLoad(vertexShaderFileName, fragmentShaderFileName, defines);
+        finishLoad();
+    }
+
+    void Shader::beginLoad(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines)
+    {
+        this->loadStart = std::chrono::steady_clock::now();
+        this->loadName = vertexShaderFileName + " + " + fragmentShaderFileName;
+        this->vertexShaderFileName = vertexShaderFileName;
+        this->fragmentShaderFileName = fragmentShaderFileName;
+        this->defines = defines;
+        if (!defines.empty()) {
+            this->loadName += " [" + ShaderPreprocessor::toString(defines) + "]";
+        }
+        this->pendingVertexShader = 0;
+        this->pendingFragmentShader = 0;
+
+        std::string v = readShaderFile(vertexShaderFileName, this->vertexSourceFiles);
+        std::string f = readShaderFile(fragmentShaderFileName, this->fragmentSourceFiles);
+
+        // try the program linked by a previous launch first
+        ProgramBinaryCache& programCache = ProgramBinaryCache::getInstance();
+        this->cacheKey = programCache.makeKey(v, f);
+        this->shaderProgram = glCreateProgram();
+        this->cacheHit = programCache.load(this->cacheKey, this->shaderProgram);
+        if (this->cacheHit) {
+            return;
+        }
+        // a rejected binary leaves the program object unusable
+        glDeleteProgram(this->shaderProgram);
+
+        //parse and compile the vertex shader
         const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
-        //check compilation status
-        shaderCompileLog(vertexShader);
-
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
+        this->pendingVertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(this->pendingVertexShader, 1, &vertexShaderString, NULL);
+        glCompileShader(this->pendingVertexShader);
+
+        //parse and compile the fragment shader
         const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
-        //check compilation status
-        shaderCompileLog(fragmentShader);
-
-        //attach and link the shader programs
+        this->pendingFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(this->pendingFragmentShader, 1, &fragmentShaderString, NULL);
+        glCompileShader(this->pendingFragmentShader);
+
+        //attach and link the shader programs - the status is only queried by finishLoad,
+        //so the driver can compile in the background in the meantime
         this->shaderProgram = glCreateProgram();
-        glAttachShader(this->shaderProgram, vertexShader);
-        glAttachShader(this->shaderProgram, fragmentShader);
+        glAttachShader(this->shaderProgram, this->pendingVertexShader);
+        glAttachShader(this->shaderProgram, this->pendingFragmentShader);
+        glProgramParameteri(this->shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(this->shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        //check linking info
-        shaderLinkLog(this->shaderProgram);
+    }
+
+    bool Shader::isLoadComplete()
+    {
+        if (this->cacheHit || !(GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)) {
+            return true;
+        }
+        // GL_COMPLETION_STATUS_KHR and GL_COMPLETION_STATUS_ARB have the same value
+        GLint completed = GL_TRUE;
+        glGetProgramiv(this->shaderProgram, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    bool Shader::finishLoad()
+    {
+        ProgramBinaryCache& programCache = ProgramBinaryCache::getInstance();
+        // a program from the cache is already known to be linked
+        bool linked = true;
+        if (!this->cacheHit) {
+            //check compilation status
+            shaderCompileLog(this->pendingVertexShader, this->vertexSourceFiles);
+            shaderCompileLog(this->pendingFragmentShader, this->fragmentSourceFiles);
+            glDeleteShader(this->pendingVertexShader);
+            glDeleteShader(this->pendingFragmentShader);
+            this->pendingVertexShader = 0;
+            this->pendingFragmentShader = 0;
+
+            //check linking info
+            linked = shaderLinkLog(this->shaderProgram);
+            if (linked) {
+                programCache.store(this->cacheKey, this->shaderProgram);
+            }
+        }
+
+        // from the submission, so with a batch the times overlap
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->loadStart).count();
+        programCache.addLoadTime(this->cacheHit, milliseconds);
+        std::cout << (this->cacheHit ? "Cached " : "Compiled ") << this->loadName << " in " << milliseconds << " ms" << std::endl;
+        return linked;
+    }
+
+    std::string Shader::getVertexShaderFileName()
+    {
+        return this->vertexShaderFileName;
+    }
+
+    std::string Shader::getFragmentShaderFileName()
+    {
+        return this->fragmentShaderFileName;
+    }
+
+    ShaderDefines Shader::getDefines()
+    {
+        return this->defines;
+    }
+
+    std::vector<std::string> Shader::getSourceFiles()
+    {
+        std::vector<std::string> sourceFiles = this->vertexSourceFiles;
+        sourceFiles.insert(sourceFiles.end(), this->fragmentSourceFiles.begin(), this->fragmentSourceFiles.end());
+        return sourceFiles;
     }
 
     void Shader::useShaderProgram()
     {
-        glUseProgram(this->shaderProgram);
+        GLStateCache::getInstance().useProgram(this->shaderProgram);
     }
 
 }
@@ -3,11 +3,15 @@
 
 #include <GL/glew.h>
 
+#include "ShaderPreprocessor.hpp"
+
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace gps {
 
@@ -15,13 +19,46 @@ class Shader
 {
 public:
     GLuint shaderProgram;
-    void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+    // loads the linked program from the program binary cache, or compiles and links it (and caches it);
+    // the defines select the permutation of the sources (see ShaderPreprocessor)
+    void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines = ShaderDefines());
     void useShaderProgram();
 
+    // loadShader in two steps, see ShaderBatch: beginLoad submits the work to the driver without waiting for it,
+    // finishLoad checks the results
+    void beginLoad(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines = ShaderDefines());
+    // true if finishLoad would not wait for the driver
+    bool isLoadComplete();
+    // returns true if the program is usable
+    bool finishLoad();
+
+    // source files of the last load, see ShaderWatcher
+    std::string getVertexShaderFileName();
+    std::string getFragmentShaderFileName();
+    ShaderDefines getDefines();
+    // the shader files and the files they include
+    std::vector<std::string> getSourceFiles();
+
 private:
-    std::string readShaderFile(std::string fileName);
-    void shaderCompileLog(GLuint shaderId);
-    void shaderLinkLog(GLuint shaderProgramId);
+    std::string readShaderFile(std::string fileName, std::vector<std::string>& sourceFiles);
+    void shaderCompileLog(GLuint shaderId, const std::vector<std::string>& sourceFiles);
+    // returns true if the program was linked
+    bool shaderLinkLog(GLuint shaderProgramId);
+
+    std::string vertexShaderFileName;
+    std::string fragmentShaderFileName;
+    ShaderDefines defines;
+    // by source number, for the compile errors
+    std::vector<std::string> vertexSourceFiles;
+    std::vector<std::string> fragmentSourceFiles;
+
+    // state of the load between beginLoad and finishLoad
+    GLuint pendingVertexShader;
+    GLuint pendingFragmentShader;
+    std::string cacheKey;
+    bool cacheHit;
+    std::string loadName;
+    std::chrono::steady_clock::time_point loadStart;
 };
 
 }
@@ -0,0 +1,57 @@
+#include "ShaderBatch.hpp"
+
+namespace gps {
+
+    void ShaderBatch::add(gps::Shader* shader, std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines) {
+        Entry entry;
+        entry.shader = shader;
+        entry.vertexShaderFileName = vertexShaderFileName;
+        entry.fragmentShaderFileName = fragmentShaderFileName;
+        entry.defines = defines;
+        entries.push_back(entry);
+    }
+
+    void ShaderBatch::submit() {
+        submitTime = std::chrono::steady_clock::now();
+
+        // let the driver use as many compiler threads as it wants
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        else if (GLEW_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            entries[i].shader->beginLoad(entries[i].vertexShaderFileName, entries[i].fragmentShaderFileName, entries[i].defines);
+        }
+    }
+
+    bool ShaderBatch::finishCompleted() {
+        // the logs are only read once the driver is done, so reading them does not block
+        size_t remaining = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].shader->isLoadComplete()) {
+                entries[i].shader->finishLoad();
+            }
+            else {
+                entries[remaining++] = entries[i];
+            }
+        }
+        entries.resize(remaining);
+        return entries.empty();
+    }
+
+    void ShaderBatch::finish() {
+        std::chrono::steady_clock::time_point finishTime = std::chrono::steady_clock::now();
+
+        while (!finishCompleted()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        std::cout << "Shader batch: " << std::chrono::duration<double, std::milli>(end - submitTime).count() << " ms from submission, "
+            << std::chrono::duration<double, std::milli>(end - finishTime).count() << " ms waited at the end" << std::endl;
+    }
+
+}
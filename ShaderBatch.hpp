@@ -0,0 +1,47 @@
+#ifndef ShaderBatch_hpp
+#define ShaderBatch_hpp
+
+#include <GL/glew.h>
+
+#include "Shader.hpp"
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+// Loads several shader programs together: all of them are submitted to the driver first, and their
+// status is only checked at the end. With KHR_parallel_shader_compile the driver compiles them on its
+// own threads, so the application can load models and textures while they are compiled.
+class ShaderBatch
+{
+public:
+    // the shader must stay alive until finish()
+    void add(gps::Shader* shader, std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines = ShaderDefines());
+
+    // starts compiling (or loading from the program cache) every added program
+    void submit();
+    // checks the programs which are ready (GL_COMPLETION_STATUS_KHR), without waiting for the others;
+    // true when none is left (without parallel compilation, they are all checked at once)
+    bool finishCompleted();
+    // waits for the remaining programs, checking them in the order they complete
+    void finish();
+
+private:
+    struct Entry
+    {
+        gps::Shader* shader;
+        std::string vertexShaderFileName;
+        std::string fragmentShaderFileName;
+        ShaderDefines defines;
+    };
+
+    std::vector<Entry> entries;
+    std::chrono::steady_clock::time_point submitTime;
+};
+
+}
+
+#endif /* ShaderBatch_hpp */
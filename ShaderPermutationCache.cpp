@@ -0,0 +1,68 @@
+#include "ShaderPermutationCache.hpp"
+
+namespace gps {
+
+    ShaderPermutationCache& ShaderPermutationCache::getInstance() {
+        // programs belong to the context, so there is a single cache per context
+        static ShaderPermutationCache instance;
+        return instance;
+    }
+
+    ShaderPermutationCache::ShaderPermutationCache() {
+        this->requestCount = 0;
+        this->compileCount = 0;
+    }
+
+    std::string ShaderPermutationCache::makeKey(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines) {
+        return vertexShaderFileName + "|" + fragmentShaderFileName + "|" + ShaderPreprocessor::toString(defines);
+    }
+
+    gps::Shader* ShaderPermutationCache::get(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines, bool* created) {
+        requestCount++;
+        if (created != NULL) {
+            *created = false;
+        }
+
+        std::string key = makeKey(vertexShaderFileName, fragmentShaderFileName, defines);
+        std::map<std::string, gps::Shader*>::iterator it = permutations.find(key);
+        if (it != permutations.end()) {
+            return it->second;
+        }
+
+        gps::Shader* shader = new gps::Shader();
+        shader->loadShader(vertexShaderFileName, fragmentShaderFileName, defines);
+        permutations[key] = shader;
+        ownedShaders.insert(shader);
+        compileCount++;
+        if (created != NULL) {
+            *created = true;
+        }
+        return shader;
+    }
+
+    void ShaderPermutationCache::add(gps::Shader* shader) {
+        permutations[makeKey(shader->getVertexShaderFileName(), shader->getFragmentShaderFileName(), shader->getDefines())] = shader;
+    }
+
+    void ShaderPermutationCache::destroy() {
+        for (std::set<gps::Shader*>::iterator it = ownedShaders.begin(); it != ownedShaders.end(); it++) {
+            glDeleteProgram((*it)->shaderProgram);
+            delete *it;
+        }
+        ownedShaders.clear();
+        permutations.clear();
+    }
+
+    size_t ShaderPermutationCache::getPermutationCount() {
+        return permutations.size();
+    }
+
+    void ShaderPermutationCache::printStats(std::ostream& out) {
+        out << "Shader permutations: " << permutations.size() << " loaded, " << compileCount << " compiled for "
+            << requestCount << " request(s)" << std::endl;
+        for (std::map<std::string, gps::Shader*>::iterator it = permutations.begin(); it != permutations.end(); it++) {
+            out << "  " << it->first << " -> program " << it->second->shaderProgram << std::endl;
+        }
+    }
+
+}
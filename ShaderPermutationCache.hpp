@@ -0,0 +1,49 @@
+#ifndef ShaderPermutationCache_hpp
+#define ShaderPermutationCache_hpp
+
+#include <GL/glew.h>
+
+#include "Shader.hpp"
+#include "ShaderPreprocessor.hpp"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+
+namespace gps {
+
+// The loaded permutations of the shaders, by files and defines, so each variant is compiled once per run
+// (and, through the program binary cache, once per driver). Permutations are compiled the first time
+// they are requested; shaders loaded elsewhere (e.g. by a ShaderBatch) can be added to be shared too.
+class ShaderPermutationCache
+{
+public:
+    static ShaderPermutationCache& getInstance();
+
+    // the loaded shader of the permutation; created is set to true if this call compiled it
+    gps::Shader* get(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines, bool* created = NULL);
+    // a loaded shader owned by the caller, returned by get for its permutation
+    void add(gps::Shader* shader);
+
+    // deletes the programs of the permutations compiled by get
+    void destroy();
+
+    size_t getPermutationCount();
+    void printStats(std::ostream& out);
+
+private:
+    ShaderPermutationCache();
+
+    static std::string makeKey(std::string vertexShaderFileName, std::string fragmentShaderFileName, const ShaderDefines& defines);
+
+    std::map<std::string, gps::Shader*> permutations;
+    // the shaders created by get
+    std::set<gps::Shader*> ownedShaders;
+    int requestCount;
+    int compileCount;
+};
+
+}
+
+#endif /* ShaderPermutationCache_hpp */
@@ -0,0 +1,92 @@
+#include "ShaderPreprocessor.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace gps {
+
+    static std::string directoryOf(const std::string& fileName) {
+        size_t separator = fileName.find_last_of("/\\");
+        if (separator == std::string::npos) {
+            return "";
+        }
+        return fileName.substr(0, separator + 1);
+    }
+
+    static bool startsWith(const std::string& line, const std::string& prefix) {
+        return line.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    std::string ShaderPreprocessor::process(const std::string& fileName, const ShaderDefines& defines, std::vector<std::string>& sourceFiles) {
+        std::string output;
+        sourceFiles.clear();
+        append(fileName, defines, output, sourceFiles);
+        return output;
+    }
+
+    std::string ShaderPreprocessor::toString(const ShaderDefines& defines) {
+        std::string result;
+        for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); it++) {
+            if (!result.empty()) {
+                result += " ";
+            }
+            result += it->first + "=" + it->second;
+        }
+        return result;
+    }
+
+    void ShaderPreprocessor::append(const std::string& fileName, const ShaderDefines& defines, std::string& output, std::vector<std::string>& sourceFiles) {
+        // included once, which also breaks include cycles
+        if (std::find(sourceFiles.begin(), sourceFiles.end(), fileName) != sourceFiles.end()) {
+            return;
+        }
+        int sourceNumber = (int)sourceFiles.size();
+        sourceFiles.push_back(fileName);
+
+        std::ifstream file(fileName.c_str());
+        if (!file.is_open()) {
+            std::cout << "Shader preprocessor: cannot open " << fileName << std::endl;
+            output += "#error cannot open " + fileName + "\n";
+            return;
+        }
+        if (sourceNumber > 0) {
+            output += "#line 1 " + std::to_string(sourceNumber) + "\n";
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            std::string directive = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+
+            if (startsWith(directive, "#version")) {
+                // only the main file declares the version, the defines must follow it
+                if (sourceNumber == 0) {
+                    output += line + "\n";
+                    for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); it++) {
+                        output += "#define " + it->first + " " + it->second + "\n";
+                    }
+                }
+                output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+            }
+            else if (startsWith(directive, "#include")) {
+                size_t begin = directive.find('"');
+                size_t end = directive.find('"', begin + 1);
+                if (begin == std::string::npos || end == std::string::npos) {
+                    output += "#error malformed #include in " + fileName + "\n";
+                    continue;
+                }
+                append(directoryOf(fileName) + directive.substr(begin + 1, end - begin - 1), defines, output, sourceFiles);
+                output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+            }
+            else {
+                output += line + "\n";
+            }
+        }
+    }
+
+}
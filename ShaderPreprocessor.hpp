@@ -0,0 +1,32 @@
+#ifndef ShaderPreprocessor_hpp
+#define ShaderPreprocessor_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+// compile-time options of a shader, NAME -> value, inserted as #define lines after #version
+typedef std::map<std::string, std::string> ShaderDefines;
+
+// Expands the GLSL sources before they are compiled:
+// - #include "file" is replaced by the file (path relative to the including file), each file is included once
+// - the defines select the permutation; the shaders use #if on them, so unused code is compiled out
+// #line directives keep the line numbers of the compile errors, with the index of the file as source number.
+class ShaderPreprocessor
+{
+public:
+    // the expanded source of the file; sourceFiles receives the file and its includes, by source number
+    static std::string process(const std::string& fileName, const ShaderDefines& defines, std::vector<std::string>& sourceFiles);
+
+    // "NAME=value NAME=value", for names and keys of the permutations
+    static std::string toString(const ShaderDefines& defines);
+
+private:
+    static void append(const std::string& fileName, const ShaderDefines& defines, std::string& output, std::vector<std::string>& sourceFiles);
+};
+
+}
+
+#endif /* ShaderPreprocessor_hpp */
@@ -0,0 +1,214 @@
+#include "ShaderWatcher.hpp"
+#include "GLStateCache.hpp"
+#include "MaterialLibrary.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace gps {
+
+    // how long the watching thread sleeps between checks of the running flag (or of the files)
+    const int WATCH_INTERVAL_MS = 250;
+
+    static std::string directoryOf(const std::string& fileName) {
+        size_t separator = fileName.find_last_of("/\\");
+        if (separator == std::string::npos) {
+            return ".";
+        }
+        return fileName.substr(0, separator);
+    }
+
+    static std::string joinPath(const std::string& directory, const std::string& name) {
+        if (directory == ".") {
+            return name;
+        }
+        return directory + "/" + name;
+    }
+
+    ShaderWatcher::ShaderWatcher() {
+        this->running = false;
+    }
+
+    ShaderWatcher::~ShaderWatcher() {
+        stop();
+    }
+
+    void ShaderWatcher::watch(gps::Shader* shader) {
+        Entry entry;
+        entry.shader = shader;
+        entry.reloading = false;
+        entries.push_back(entry);
+        addFiles(shader->getSourceFiles());
+    }
+
+    void ShaderWatcher::addFiles(const std::vector<std::string>& sourceFiles) {
+        std::lock_guard<std::mutex> lock(filesMutex);
+        for (size_t i = 0; i < sourceFiles.size(); i++) {
+            fileNames.insert(sourceFiles[i]);
+            std::string directory = directoryOf(sourceFiles[i]);
+            if (directories.insert(directory).second) {
+                newDirectories.insert(directory);
+            }
+        }
+    }
+
+    void ShaderWatcher::start() {
+        if (running || entries.empty()) {
+            return;
+        }
+        running = true;
+        watchThread = std::thread(&ShaderWatcher::watchLoop, this);
+    }
+
+    void ShaderWatcher::stop() {
+        running = false;
+        if (watchThread.joinable()) {
+            watchThread.join();
+        }
+    }
+
+    void ShaderWatcher::fileChanged(const std::string& fileName) {
+        std::lock_guard<std::mutex> lock(filesMutex);
+        if (fileNames.count(fileName) > 0) {
+            changedFiles.insert(fileName);
+        }
+    }
+
+#ifdef __linux__
+    void ShaderWatcher::watchLoop() {
+        int inotifyFd = inotify_init1(IN_NONBLOCK);
+        if (inotifyFd < 0) {
+            std::cout << "ShaderWatcher: inotify is not available" << std::endl;
+            return;
+        }
+
+        std::map<int, std::string> watchedDirectories;
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (running) {
+            // the directories of the shaders watched since the last check
+            std::set<std::string> added;
+            {
+                std::lock_guard<std::mutex> lock(filesMutex);
+                added.swap(newDirectories);
+            }
+            for (std::set<std::string>::iterator it = added.begin(); it != added.end(); it++) {
+                // editors either rewrite the file or replace it by a renamed temporary file
+                int wd = inotify_add_watch(inotifyFd, it->c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd >= 0) {
+                    watchedDirectories[wd] = *it;
+                }
+                else {
+                    std::cout << "ShaderWatcher: cannot watch " << *it << ", its shaders are not reloaded" << std::endl;
+                }
+            }
+
+            struct pollfd pfd;
+            pfd.fd = inotifyFd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, WATCH_INTERVAL_MS) <= 0) {
+                continue;
+            }
+
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+                    const struct inotify_event* event = (const struct inotify_event*)p;
+                    if (event->len > 0 && watchedDirectories.count(event->wd) > 0) {
+                        fileChanged(joinPath(watchedDirectories[event->wd], event->name));
+                    }
+                }
+            }
+        }
+
+        close(inotifyFd);
+    }
+#else
+    void ShaderWatcher::watchLoop() {
+        // no inotify: compare the modification times of the files
+        std::map<std::string, time_t> modificationTimes;
+        while (running) {
+            std::set<std::string> files;
+            {
+                std::lock_guard<std::mutex> lock(filesMutex);
+                files = fileNames;
+            }
+            for (std::set<std::string>::iterator it = files.begin(); it != files.end(); it++) {
+                struct stat status;
+                if (stat(it->c_str(), &status) != 0) {
+                    continue;
+                }
+                std::map<std::string, time_t>::iterator previous = modificationTimes.find(*it);
+                if (previous != modificationTimes.end() && previous->second != status.st_mtime) {
+                    fileChanged(*it);
+                }
+                modificationTimes[*it] = status.st_mtime;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+        }
+    }
+#endif
+
+    std::vector<gps::Shader*> ShaderWatcher::update() {
+        std::set<std::string> changed;
+        {
+            std::lock_guard<std::mutex> lock(filesMutex);
+            changed.swap(changedFiles);
+        }
+
+        std::vector<gps::Shader*> replaced;
+        // changes of shaders which are still reloading, picked up once the current reload is finished
+        std::set<std::string> deferred;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Entry& entry = entries[i];
+            std::string vertexShaderFileName = entry.shader->getVertexShaderFileName();
+            std::string fragmentShaderFileName = entry.shader->getFragmentShaderFileName();
+            std::vector<std::string> sourceFiles = entry.shader->getSourceFiles();
+
+            bool modified = false;
+            for (size_t f = 0; f < sourceFiles.size(); f++) {
+                modified = modified || changed.count(sourceFiles[f]) > 0;
+            }
+            if (modified && entry.reloading) {
+                deferred.insert(sourceFiles.begin(), sourceFiles.end());
+            }
+            else if (modified) {
+                entry.candidate.beginLoad(vertexShaderFileName, fragmentShaderFileName, entry.shader->getDefines());
+                entry.reloading = true;
+            }
+            if (!entry.reloading || !entry.candidate.isLoadComplete()) {
+                continue;
+            }
+            entry.reloading = false;
+
+            if (!entry.candidate.finishLoad()) {
+                std::cout << "Keeping the previous program of " << vertexShaderFileName << " + " << fragmentShaderFileName << std::endl;
+                glDeleteProgram(entry.candidate.shaderProgram);
+                continue;
+            }
+
+            // the new sources may include other files
+            GLuint previousProgram = entry.shader->shaderProgram;
+            *entry.shader = entry.candidate;
+            glDeleteProgram(previousProgram);
+            addFiles(entry.shader->getSourceFiles());
+            // the deleted name can be given to a later program
+            GLStateCache::getInstance().invalidate();
+            MaterialLibrary::getInstance().forgetProgram(previousProgram);
+            replaced.push_back(entry.shader);
+        }
+
+        if (!deferred.empty()) {
+            std::lock_guard<std::mutex> lock(filesMutex);
+            changedFiles.insert(deferred.begin(), deferred.end());
+        }
+        return replaced;
+    }
+
+}
@@ -0,0 +1,68 @@
+#ifndef ShaderWatcher_hpp
+#define ShaderWatcher_hpp
+
+#include <GL/glew.h>
+
+#include "Shader.hpp"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+// Reloads shader programs when their source files (or the files they include) change, while the application keeps running.
+// A background thread watches the directories of the files (inotify on Linux, modification times
+// elsewhere); update() recompiles the affected programs on the GL thread without waiting for the
+// driver, and swaps a program only when the new one has linked - on errors the old one stays in use.
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    // the shader must be loaded and stay alive while it is watched; it can be added after start()
+    void watch(gps::Shader* shader);
+
+    void start();
+    void stop();
+
+    // called once per frame on the GL thread; returns the shaders whose program was replaced,
+    // their uniforms have to be set again
+    std::vector<gps::Shader*> update();
+
+private:
+    struct Entry
+    {
+        gps::Shader* shader;
+        // new program being compiled, valid while reloading is true
+        gps::Shader candidate;
+        bool reloading;
+    };
+
+    void watchLoop();
+    void fileChanged(const std::string& fileName);
+    // the files and their directories are watched from now on
+    void addFiles(const std::vector<std::string>& sourceFiles);
+
+    std::vector<Entry> entries;
+
+    // shared by the watching thread and the GL thread
+    std::mutex filesMutex;
+    std::set<std::string> fileNames;
+    std::set<std::string> directories;
+    // directories not given to the watching thread yet
+    std::set<std::string> newDirectories;
+    std::set<std::string> changedFiles;
+
+    std::thread watchThread;
+    std::atomic<bool> running;
+};
+
+}
+
+#endif /* ShaderWatcher_hpp */
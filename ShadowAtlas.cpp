@@ -0,0 +1,276 @@
+#include "ShadowAtlas.hpp"
+#include "GLStateCache.hpp"
+#include "Frustum.hpp"
+
+#include <algorithm>
+
+namespace gps {
+
+    ShadowAtlas::ShadowAtlas() {
+        this->texture = 0;
+        this->framebuffer = 0;
+        this->frame = 0;
+        this->nextSlot = 0;
+        this->renderedTiles = 0;
+    }
+
+    void ShadowAtlas::init() {
+        glGenTextures(1, &texture);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        // sampled by a sampler2DShadow, as the shadow map of the directional light
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        // the shaders keep the taps inside the tiles
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ShadowAtlas: incomplete framebuffer" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void ShadowAtlas::destroy() {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+        framebuffer = 0;
+        texture = 0;
+        requests.clear();
+        contents.clear();
+        casters.clear();
+    }
+
+    void ShadowAtlas::beginFrame() {
+        requests.clear();
+        frame++;
+    }
+
+    void ShadowAtlas::addMovingCaster(const void* object, glm::mat4 model, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+        Caster caster;
+        std::map<const void*, Caster>::iterator previous = casters.find(object);
+        // a new caster may already be in the tiles, it is treated as moved
+        caster.previousModel = previous != casters.end() ? previous->second.model : model;
+        caster.model = model;
+        caster.boundsMin = boundsMin;
+        caster.boundsMax = boundsMax;
+        caster.moved = previous == casters.end() || caster.previousModel != model;
+        casters[object] = caster;
+    }
+
+    bool ShadowAtlas::hasMovingCaster(glm::mat4 lightSpaceTrMatrix) {
+        for (std::map<const void*, Caster>::iterator it = casters.begin(); it != casters.end(); it++) {
+            Caster& caster = it->second;
+            if (!caster.moved) {
+                continue;
+            }
+            // the old position, for its shadow to be removed
+            if (Frustum(lightSpaceTrMatrix * caster.model).intersectsBox(caster.boundsMin, caster.boundsMax)
+                || Frustum(lightSpaceTrMatrix * caster.previousModel).intersectsBox(caster.boundsMin, caster.boundsMax)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t ShadowAtlas::request(const void* light, glm::mat4 lightSpaceTrMatrix, float coverage) {
+        Request request;
+        request.light = light;
+        request.lightSpaceTrMatrix = lightSpaceTrMatrix;
+        request.size = 0;
+        request.tile.x = 0;
+        request.tile.y = 0;
+        request.tile.size = 0;
+        request.render = false;
+        if (coverage > 0.0f) {
+            // a light covering half of the screen gets the largest tile
+            float wantedSize = 2.0f * coverage * MAX_TILE_SIZE;
+            request.size = MIN_TILE_SIZE;
+            while (request.size < MAX_TILE_SIZE && request.size < wantedSize) {
+                request.size *= 2;
+            }
+        }
+        requests.push_back(request);
+        return requests.size() - 1;
+    }
+
+    void ShadowAtlas::allocate() {
+        // the tiles of the previous frame are kept while the lights want the same sizes
+        bool samePlacement = true;
+        for (size_t i = 0; i < requests.size(); i++) {
+            Request& request = requests[i];
+            if (request.size == 0) {
+                continue;
+            }
+            std::map<const void*, Content>::iterator content = contents.find(request.light);
+            if (content == contents.end() || content->second.tile.size != request.size) {
+                samePlacement = false;
+                break;
+            }
+            request.tile = content->second.tile;
+        }
+        if (!samePlacement) {
+            // shrink every tile until they fit
+            while (!pack()) {
+                bool shrunk = false;
+                for (size_t i = 0; i < requests.size(); i++) {
+                    if (requests[i].size > MIN_TILE_SIZE) {
+                        requests[i].size /= 2;
+                        shrunk = true;
+                    }
+                }
+                if (!shrunk) {
+                    break;
+                }
+            }
+        }
+
+        std::map<const void*, Content> previousContents;
+        previousContents.swap(contents);
+        renderedTiles = 0;
+        for (size_t i = 0; i < requests.size(); i++) {
+            Request& request = requests[i];
+            if (request.tile.size == 0) {
+                continue;
+            }
+            Content content;
+            std::map<const void*, Content>::iterator previous = previousContents.find(request.light);
+            bool known = previous != previousContents.end();
+            if (known) {
+                content = previous->second;
+            }
+            else {
+                content.renderedFrame = -1;
+                content.slot = nextSlot++;
+            }
+            bool moved = !known || content.tile.x != request.tile.x || content.tile.y != request.tile.y || content.tile.size != request.tile.size;
+            bool lightMoved = !known || content.lightSpaceTrMatrix != request.lightSpaceTrMatrix;
+            bool casterMoved = hasMovingCaster(request.lightSpaceTrMatrix);
+            // only the tiles without moving casters wait for their turn
+            bool periodicUpdate = (frame + content.slot) % STATIC_UPDATE_INTERVAL == 0;
+            request.render = moved || lightMoved || casterMoved || periodicUpdate || content.renderedFrame < 0;
+
+            content.tile = request.tile;
+            content.lightSpaceTrMatrix = request.lightSpaceTrMatrix;
+            if (request.render) {
+                content.renderedFrame = frame;
+                renderedTiles++;
+            }
+            // the lights without a tile this frame lose their content
+            contents[request.light] = content;
+        }
+    }
+
+    bool ShadowAtlas::pack() {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < requests.size(); i++) {
+            requests[i].tile.size = 0;
+            if (requests[i].size > 0) {
+                order.push_back(i);
+            }
+        }
+        // largest first, so the free squares are always split evenly
+        for (size_t i = 1; i < order.size(); i++) {
+            for (size_t j = i; j > 0 && requests[order[j]].size > requests[order[j - 1]].size; j--) {
+                std::swap(order[j], order[j - 1]);
+            }
+        }
+
+        std::vector<ShadowTile> freeTiles;
+        ShadowTile atlas;
+        atlas.x = 0;
+        atlas.y = 0;
+        atlas.size = ATLAS_SIZE;
+        freeTiles.push_back(atlas);
+        for (size_t i = 0; i < order.size(); i++) {
+            Request& request = requests[order[i]];
+            // the smallest free square which is large enough
+            int best = -1;
+            for (size_t f = 0; f < freeTiles.size(); f++) {
+                if (freeTiles[f].size >= request.size && (best < 0 || freeTiles[f].size < freeTiles[best].size)) {
+                    best = (int)f;
+                }
+            }
+            if (best < 0) {
+                return false;
+            }
+            ShadowTile tile = freeTiles[best];
+            freeTiles.erase(freeTiles.begin() + best);
+            while (tile.size > request.size) {
+                tile.size /= 2;
+                ShadowTile right = { tile.x + tile.size, tile.y, tile.size };
+                ShadowTile top = { tile.x, tile.y + tile.size, tile.size };
+                ShadowTile corner = { tile.x + tile.size, tile.y + tile.size, tile.size };
+                freeTiles.push_back(right);
+                freeTiles.push_back(top);
+                freeTiles.push_back(corner);
+            }
+            request.tile = tile;
+        }
+        return true;
+    }
+
+    size_t ShadowAtlas::getRequestCount() {
+        return requests.size();
+    }
+
+    ShadowTile ShadowAtlas::getTile(size_t request) {
+        return requests[request].tile;
+    }
+
+    bool ShadowAtlas::needsRendering(size_t request) {
+        return requests[request].render;
+    }
+
+    glm::mat4 ShadowAtlas::getLightSpaceTrMatrix(size_t request) {
+        return requests[request].lightSpaceTrMatrix;
+    }
+
+    glm::vec4 ShadowAtlas::getTextureRect(size_t request) {
+        ShadowTile tile = requests[request].tile;
+        return glm::vec4(tile.x, tile.y, tile.size, tile.size) / (float)ATLAS_SIZE;
+    }
+
+    void ShadowAtlas::beginRendering() {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        // the clears must not reach the other tiles
+        glEnable(GL_SCISSOR_TEST);
+    }
+
+    void ShadowAtlas::beginTile(size_t request) {
+        ShadowTile tile = requests[request].tile;
+        glViewport(tile.x, tile.y, tile.size, tile.size);
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void ShadowAtlas::endRendering() {
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    GLuint ShadowAtlas::getTexture() {
+        return texture;
+    }
+
+    void ShadowAtlas::printStats(std::ostream& out) {
+        int usedTiles = 0;
+        int usedArea = 0;
+        for (size_t i = 0; i < requests.size(); i++) {
+            if (requests[i].tile.size > 0) {
+                usedTiles++;
+                usedArea += requests[i].tile.size * requests[i].tile.size;
+            }
+        }
+        out << "Shadow atlas: " << usedTiles << " tile(s), " << (100.0 * usedArea / ((double)ATLAS_SIZE * ATLAS_SIZE))
+            << "% used, " << renderedTiles << " rendered in the last frame" << std::endl;
+    }
+
+}
@@ -0,0 +1,114 @@
+#ifndef ShadowAtlas_hpp
+#define ShadowAtlas_hpp
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace gps {
+
+// Square part of the atlas given to one light
+struct ShadowTile
+{
+    int x;
+    int y;
+    // 0 - the light has no tile this frame
+    int size;
+};
+
+// The shadow maps of the spot lights, packed into one depth texture.
+// Every frame the lights request a tile, with a size chosen from the part of the screen they light;
+// the tiles are packed as power of two squares (largest first, shrinking them when the atlas is full).
+// A tile is rendered again when it is new or moved, when its light moved, or when a moving caster
+// is (or was, in the previous frame) inside the frustum of its light; otherwise only every
+// STATIC_UPDATE_INTERVAL frames (the lights are spread over the frames), to catch the other changes.
+class ShadowAtlas
+{
+public:
+    static const int ATLAS_SIZE = 2048;
+    static const int MIN_TILE_SIZE = 128;
+    static const int MAX_TILE_SIZE = 1024;
+    static const int STATIC_UPDATE_INTERVAL = 8;
+
+    ShadowAtlas();
+
+    void init();
+    void destroy();
+
+    // forgets the requests of the previous frame
+    void beginFrame();
+    // an object which can move, with its model matrix of this frame and its object space bounding box;
+    // called every frame before allocate(), the object is only used as a key, to compare with its last position
+    void addMovingCaster(const void* object, glm::mat4 model, glm::vec3 boundsMin, glm::vec3 boundsMax);
+    // coverage - fraction of the screen height lit by the light, in [0, 1] (0 - not visible, no tile);
+    // the light is only used as a key, to follow its tile over the frames; returns the index of the request
+    size_t request(const void* light, glm::mat4 lightSpaceTrMatrix, float coverage);
+    // packs the requested tiles and decides which ones are rendered this frame
+    void allocate();
+
+    size_t getRequestCount();
+    ShadowTile getTile(size_t request);
+    bool needsRendering(size_t request);
+    glm::mat4 getLightSpaceTrMatrix(size_t request);
+    // offset (xy) and scale (zw) of the tile in texture coordinates, zero scale without a tile
+    glm::vec4 getTextureRect(size_t request);
+
+    // renders into the atlas: bind, then clear and set the viewport of every tile before drawing it
+    void beginRendering();
+    void beginTile(size_t request);
+    void endRendering();
+
+    GLuint getTexture();
+    void printStats(std::ostream& out);
+
+private:
+    struct Request
+    {
+        const void* light;
+        glm::mat4 lightSpaceTrMatrix;
+        int size;
+        ShadowTile tile;
+        bool render;
+    };
+
+    // what the atlas holds for a light, kept over the frames
+    struct Content
+    {
+        ShadowTile tile;
+        glm::mat4 lightSpaceTrMatrix;
+        int renderedFrame;
+        // spreads the updates of the static lights over the frames
+        int slot;
+    };
+
+    struct Caster
+    {
+        glm::mat4 model;
+        glm::mat4 previousModel;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        // the model changed since the previous frame
+        bool moved;
+    };
+
+    // places squares of the requested sizes, false if they do not fit
+    bool pack();
+    // a caster which moved this frame intersects the frustum of the light, at its new or its old position
+    bool hasMovingCaster(glm::mat4 lightSpaceTrMatrix);
+
+    GLuint texture;
+    GLuint framebuffer;
+    std::vector<Request> requests;
+    std::map<const void*, Content> contents;
+    std::map<const void*, Caster> casters;
+    int frame;
+    int nextSlot;
+    int renderedTiles;
+};
+
+}
+
+#endif /* ShadowAtlas_hpp */
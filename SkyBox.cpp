@@ -7,6 +7,7 @@
 //
 
 #include "SkyBox.hpp"
+#include "GLStateCache.hpp"
 
 namespace gps {
     
@@ -30,29 +31,29 @@ namespace gps {
         glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(transformedView));
         glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
         
-        glDepthFunc(GL_LEQUAL);
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.depthFunc(GL_LEQUAL);
         
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
+        stateCache.bindVertexArray(skyboxVAO);
+        stateCache.activeTexture(GL_TEXTURE0);
         glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        stateCache.bindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
         
-        glDepthFunc(GL_LESS);
+        stateCache.depthFunc(GL_LESS);
     }
     
     GLuint SkyBox::LoadSkyBoxTextures(std::vector<const GLchar*> skyBoxFaces)
     {
         GLuint textureID;
         glGenTextures(1, &textureID);
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::getInstance().activeTexture(GL_TEXTURE0);
         
         int width,height, n;
         unsigned char* image;
         int force_channels = 3;
         
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_CUBE_MAP, textureID);
         for(GLuint i = 0; i < skyBoxFaces.size(); i++)
         {
             image = stbi_load(skyBoxFaces[i], &width, &height, &n, force_channels);
@@ -70,7 +71,7 @@ namespace gps {
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_CUBE_MAP, 0);
         
         return textureID;
     }
@@ -124,14 +125,14 @@ namespace gps {
         glGenVertexArrays(1, &(this->skyboxVAO));
         glGenBuffers(1, &skyboxVBO);
         
-        glBindVertexArray(skyboxVAO);
+        GLStateCache::getInstance().bindVertexArray(skyboxVAO);
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
         
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
         
-        glBindVertexArray(0);
+        GLStateCache::getInstance().bindVertexArray(0);
     }
     
     GLuint SkyBox::GetTextureId()
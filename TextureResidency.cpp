@@ -0,0 +1,335 @@
+#include "TextureResidency.hpp"
+#include "GLStateCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    // 256 MB unless the application asks for something else
+    const size_t DEFAULT_TEXTURE_BUDGET = 256 * 1024 * 1024;
+
+    // size of one texel in video memory (drivers pad 3 channel formats to 4 bytes)
+    static size_t bytesPerTexel(GLenum internalFormat) {
+        switch (internalFormat) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+        }
+    }
+
+    // format and type of a pixel transfer compatible with the internal format; false if it is not supported
+    static bool transferFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+        switch (internalFormat) {
+        case GL_R8:
+            format = GL_RED;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case GL_RG8:
+            format = GL_RG;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case GL_RGB:
+        case GL_RGB8:
+        case GL_SRGB:
+        case GL_SRGB8:
+            format = GL_RGB;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_SRGB_ALPHA:
+        case GL_SRGB8_ALPHA8:
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case GL_R16F:
+            format = GL_RED;
+            type = GL_HALF_FLOAT;
+            return true;
+        case GL_RGBA16F:
+            format = GL_RGBA;
+            type = GL_HALF_FLOAT;
+            return true;
+        case GL_RG32F:
+            format = GL_RG;
+            type = GL_FLOAT;
+            return true;
+        case GL_RGBA32F:
+            format = GL_RGBA;
+            type = GL_FLOAT;
+            return true;
+        case GL_DEPTH_COMPONENT16:
+            format = GL_DEPTH_COMPONENT;
+            type = GL_UNSIGNED_SHORT;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    TextureResidency& TextureResidency::getInstance() {
+        // all textures share the same video memory, so there is a single manager per context
+        static TextureResidency instance;
+        return instance;
+    }
+
+    TextureResidency::TextureResidency() {
+        this->budgetBytes = DEFAULT_TEXTURE_BUDGET;
+        this->residentBytes = 0;
+        this->peakResidentBytes = 0;
+        this->currentFrame = 0;
+        this->mipsDroppedThisFrame = 0;
+        this->texturesRestoredThisFrame = 0;
+        this->totalMipsDropped = 0;
+        this->totalTexturesRestored = 0;
+    }
+
+    void TextureResidency::setBudget(size_t budgetBytes) {
+        this->budgetBytes = budgetBytes;
+        enforceBudget();
+    }
+
+    size_t TextureResidency::getBudget() {
+        return this->budgetBytes;
+    }
+
+    void TextureResidency::registerTexture(GLuint textureId, GLenum target, ReloadFunction reload) {
+        if (textureId == 0 || entries.count(textureId) > 0) {
+            return;
+        }
+
+        Entry entry;
+        GLint internalFormat;
+        GLStateCache::getInstance().bindTexture(target, textureId);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &entry.width);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &entry.height);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_DEPTH, &entry.layers);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        GLStateCache::getInstance().bindTexture(target, 0);
+
+        GLenum format, type;
+        if (!transferFormat((GLenum)internalFormat, format, type)) {
+            std::cout << "TextureResidency: texture " << textureId << " has an unsupported internal format 0x" << std::hex
+                << internalFormat << std::dec << ", it is not managed" << std::endl;
+            return;
+        }
+
+        entry.target = target;
+        entry.internalFormat = (GLenum)internalFormat;
+        if (target != GL_TEXTURE_2D_ARRAY) {
+            entry.layers = 1;
+        }
+        entry.levelCount = (int)std::floor(std::log2((double)std::max(entry.width, entry.height))) + 1;
+        entry.droppedLevels = 0;
+        entry.lastUsedFrame = currentFrame;
+        entry.reload = reload;
+
+        entries[textureId] = entry;
+        residentBytes += computeBytes(entry, 0);
+        peakResidentBytes = std::max(peakResidentBytes, residentBytes);
+
+        enforceBudget();
+    }
+
+    void TextureResidency::unregisterTexture(GLuint textureId) {
+        std::map<GLuint, Entry>::iterator it = entries.find(textureId);
+        if (it == entries.end()) {
+            return;
+        }
+        residentBytes -= residentBytesOf(it->second);
+        entries.erase(it);
+    }
+
+    void TextureResidency::touch(GLuint textureId) {
+        std::map<GLuint, Entry>::iterator it = entries.find(textureId);
+        if (it != entries.end()) {
+            it->second.lastUsedFrame = currentFrame;
+        }
+    }
+
+    void TextureResidency::beginFrame() {
+        currentFrame++;
+        mipsDroppedThisFrame = 0;
+        texturesRestoredThisFrame = 0;
+
+        // bring back the full mip chain of the textures needed by the previous frame, while they fit
+        for (std::map<GLuint, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+            Entry& entry = it->second;
+            if (entry.droppedLevels == 0 || entry.lastUsedFrame + 1 < currentFrame) {
+                continue;
+            }
+            size_t extraBytes = computeBytes(entry, 0) - residentBytesOf(entry);
+            if (residentBytes + extraBytes <= budgetBytes) {
+                restore(it->first, entry);
+            }
+        }
+
+        enforceBudget();
+    }
+
+    size_t TextureResidency::getResidentBytes(GLuint textureId) {
+        std::map<GLuint, Entry>::iterator it = entries.find(textureId);
+        if (it == entries.end()) {
+            return 0;
+        }
+        return residentBytesOf(it->second);
+    }
+
+    TextureResidencyStats TextureResidency::getStats() {
+        TextureResidencyStats stats;
+        stats.budgetBytes = budgetBytes;
+        stats.residentBytes = residentBytes;
+        stats.requestedBytes = 0;
+        stats.peakResidentBytes = peakResidentBytes;
+        stats.textureCount = (int)entries.size();
+        stats.fullyResidentCount = 0;
+        stats.evictedCount = 0;
+        stats.mipsDroppedThisFrame = mipsDroppedThisFrame;
+        stats.texturesRestoredThisFrame = texturesRestoredThisFrame;
+        stats.totalMipsDropped = totalMipsDropped;
+        stats.totalTexturesRestored = totalTexturesRestored;
+
+        for (std::map<GLuint, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+            const Entry& entry = it->second;
+            stats.requestedBytes += computeBytes(entry, 0);
+            if (entry.droppedLevels == 0) {
+                stats.fullyResidentCount++;
+            }
+            else if (entry.droppedLevels == entry.levelCount - 1) {
+                stats.evictedCount++;
+            }
+        }
+        return stats;
+    }
+
+    void TextureResidency::printStats(std::ostream& out) {
+        const double MB = 1024.0 * 1024.0;
+        TextureResidencyStats stats = getStats();
+
+        out << "Texture residency: " << stats.residentBytes / MB << " MB resident / "
+            << stats.requestedBytes / MB << " MB requested (budget " << stats.budgetBytes / MB
+            << " MB, peak " << stats.peakResidentBytes / MB << " MB)" << std::endl;
+        out << "  textures: " << stats.textureCount << ", fully resident: " << stats.fullyResidentCount
+            << ", evicted: " << stats.evictedCount << std::endl;
+        out << "  mips dropped: " << stats.totalMipsDropped << ", textures restored: " << stats.totalTexturesRestored << std::endl;
+
+        for (std::map<GLuint, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+            const Entry& entry = it->second;
+            out << "  #" << it->first << " " << entry.width << "x" << entry.height;
+            if (entry.layers > 1) {
+                out << "x" << entry.layers;
+            }
+            out << " levels " << entry.levelCount - entry.droppedLevels << "/" << entry.levelCount
+                << ", " << residentBytesOf(entry) / 1024 << " KB, last used " << currentFrame - entry.lastUsedFrame
+                << " frame(s) ago" << std::endl;
+        }
+    }
+
+    size_t TextureResidency::computeBytes(const Entry& entry, int firstLevel) {
+        size_t bytes = 0;
+        for (int level = firstLevel; level < entry.levelCount; level++) {
+            size_t levelWidth = std::max(1, entry.width >> level);
+            size_t levelHeight = std::max(1, entry.height >> level);
+            bytes += levelWidth * levelHeight * entry.layers * bytesPerTexel(entry.internalFormat);
+        }
+        return bytes;
+    }
+
+    size_t TextureResidency::residentBytesOf(const Entry& entry) {
+        return computeBytes(entry, entry.droppedLevels);
+    }
+
+    // Rebuilds the texture without its current top level from the reload function, so the driver
+    // can release that memory; the same texture name is kept and nothing is read back from the GPU.
+    bool TextureResidency::dropTopMip(GLuint textureId, Entry& entry) {
+        if (entry.droppedLevels >= entry.levelCount - 1 || !entry.reload) {
+            return false;
+        }
+
+        size_t bytesBefore = residentBytesOf(entry);
+        int firstLevel = entry.droppedLevels + 1;
+        int newLevelCount = entry.levelCount - firstLevel;
+
+        GLStateCache::getInstance().bindTexture(entry.target, textureId);
+        glTexParameteri(entry.target, GL_TEXTURE_MAX_LEVEL, newLevelCount - 1);
+        if (!entry.reload(textureId, firstLevel)) {
+            glTexParameteri(entry.target, GL_TEXTURE_MAX_LEVEL, entry.levelCount - entry.droppedLevels - 1);
+            GLStateCache::getInstance().bindTexture(entry.target, 0);
+            return false;
+        }
+
+        // release the smallest level of the longer chain, which the shorter one does not overwrite
+        GLenum format, type;
+        transferFormat(entry.internalFormat, format, type);
+        if (entry.target == GL_TEXTURE_2D_ARRAY) {
+            glTexImage3D(entry.target, newLevelCount, entry.internalFormat, 0, 0, 0, 0, format, type, NULL);
+        }
+        else {
+            glTexImage2D(entry.target, newLevelCount, entry.internalFormat, 0, 0, 0, format, type, NULL);
+        }
+        GLStateCache::getInstance().bindTexture(entry.target, 0);
+
+        entry.droppedLevels = firstLevel;
+        residentBytes -= bytesBefore - residentBytesOf(entry);
+        mipsDroppedThisFrame++;
+        totalMipsDropped++;
+        return true;
+    }
+
+    bool TextureResidency::restore(GLuint textureId, Entry& entry) {
+        if (!entry.reload) {
+            return false;
+        }
+        size_t bytesBefore = residentBytesOf(entry);
+
+        GLStateCache::getInstance().bindTexture(entry.target, textureId);
+        glTexParameteri(entry.target, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+        bool reloaded = entry.reload(textureId, 0);
+        GLStateCache::getInstance().bindTexture(entry.target, 0);
+        if (!reloaded) {
+            return false;
+        }
+
+        entry.droppedLevels = 0;
+        residentBytes += residentBytesOf(entry) - bytesBefore;
+        peakResidentBytes = std::max(peakResidentBytes, residentBytes);
+        texturesRestoredThisFrame++;
+        totalTexturesRestored++;
+        return true;
+    }
+
+    void TextureResidency::enforceBudget() {
+        while (residentBytes > budgetBytes) {
+            // least recently bound texture that was not used by the current frame; the larger one wins ties
+            std::map<GLuint, Entry>::iterator victim = entries.end();
+            for (std::map<GLuint, Entry>::iterator it = entries.begin(); it != entries.end(); it++) {
+                const Entry& entry = it->second;
+                if (entry.droppedLevels >= entry.levelCount - 1 || entry.lastUsedFrame >= currentFrame) {
+                    continue;
+                }
+                if (victim == entries.end()
+                    || entry.lastUsedFrame < victim->second.lastUsedFrame
+                    || (entry.lastUsedFrame == victim->second.lastUsedFrame && residentBytesOf(entry) > residentBytesOf(victim->second))) {
+                    victim = it;
+                }
+            }
+            if (victim == entries.end()) {
+                // everything left is needed by this frame
+                break;
+            }
+            dropTopMip(victim->first, victim->second);
+        }
+    }
+
+}
@@ -0,0 +1,96 @@
+#ifndef TextureResidency_hpp
+#define TextureResidency_hpp
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <map>
+
+namespace gps {
+
+// snapshot of the texture memory usage, for monitoring
+struct TextureResidencyStats
+{
+    size_t budgetBytes;
+    size_t residentBytes;
+    size_t requestedBytes;
+    size_t peakResidentBytes;
+    int textureCount;
+    int fullyResidentCount;
+    int evictedCount;
+    int mipsDroppedThisFrame;
+    int texturesRestoredThisFrame;
+    int totalMipsDropped;
+    int totalTexturesRestored;
+};
+
+// Keeps the video memory used by textures under a budget.
+// Every texture is registered together with a function that can re-upload its mip chain from any level.
+// When the budget is exceeded, the least recently bound textures are rebuilt without their top mip level(s),
+// down to a single texel ("evicted"); nothing is read back from the GPU. Textures that are bound again
+// get their full chain back at the start of the next frame, if the budget allows it.
+class TextureResidency
+{
+public:
+    // re-uploads the mip chain of the texture with the given id (currently bound), starting at
+    // level firstLevel of its full chain, which becomes level 0 (0 - the complete chain)
+    typedef std::function<bool(GLuint textureId, int firstLevel)> ReloadFunction;
+
+    static TextureResidency& getInstance();
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget();
+
+    // the texture must already contain its full mip chain; textures of unsupported formats are not managed
+    void registerTexture(GLuint textureId, GLenum target, ReloadFunction reload);
+    void unregisterTexture(GLuint textureId);
+
+    // marks the texture as used by the current frame
+    void touch(GLuint textureId);
+
+    // restores recently used textures and enforces the budget, called once per frame
+    void beginFrame();
+
+    size_t getResidentBytes(GLuint textureId);
+    TextureResidencyStats getStats();
+    void printStats(std::ostream& out);
+
+private:
+    struct Entry
+    {
+        GLenum target;
+        GLint width;
+        GLint height;
+        GLint layers;
+        GLenum internalFormat;
+        int levelCount;
+        // number of top levels currently dropped from the full chain
+        int droppedLevels;
+        unsigned long long lastUsedFrame;
+        ReloadFunction reload;
+    };
+
+    TextureResidency();
+
+    size_t computeBytes(const Entry& entry, int firstLevel);
+    size_t residentBytesOf(const Entry& entry);
+    bool dropTopMip(GLuint textureId, Entry& entry);
+    bool restore(GLuint textureId, Entry& entry);
+    void enforceBudget();
+
+    std::map<GLuint, Entry> entries;
+    size_t budgetBytes;
+    size_t residentBytes;
+    size_t peakResidentBytes;
+    unsigned long long currentFrame;
+    int mipsDroppedThisFrame;
+    int texturesRestoredThisFrame;
+    int totalMipsDropped;
+    int totalTexturesRestored;
+};
+
+}
+
+#endif /* TextureResidency_hpp */
@@ -0,0 +1,277 @@
+#include "TiledLightCuller.hpp"
+#include "GLStateCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace gps {
+
+    // below these, the tiles are binned on the calling thread
+    static const size_t PARALLEL_MIN_LIGHTS = 64;
+    static const int PARALLEL_MIN_ROWS_PER_THREAD = 4;
+
+    TiledLightCuller::TiledLightCuller() {
+        this->tilesX = 0;
+        this->tilesY = 0;
+        this->tilesTexture = 0;
+        this->tilesTextureWidth = 0;
+        this->tilesTextureHeight = 0;
+        this->indexBuffer = 0;
+        this->indexTexture = 0;
+        this->indexCapacity = 0;
+        this->threadCount = std::min(MAX_THREADS, std::max(1, (int)std::thread::hardware_concurrency()));
+        this->usedThreadCount = 1;
+        this->cullMilliseconds = 0.0;
+        this->workGeneration = 0;
+        this->pendingWorkers = 0;
+        this->rowsPerBand = 0;
+        this->stopping = false;
+    }
+
+    TiledLightCuller::~TiledLightCuller() {
+        stopWorkers();
+    }
+
+    void TiledLightCuller::init() {
+        glGenTextures(1, &tilesTexture);
+        glGenBuffers(1, &indexBuffer);
+        glGenTextures(1, &indexTexture);
+
+        // started once, they wait for the culls
+        stopping = false;
+        if (workers.empty()) {
+            for (int band = 1; band < threadCount; band++) {
+                workers.push_back(std::thread(&TiledLightCuller::workerLoop, this, band));
+            }
+        }
+    }
+
+    void TiledLightCuller::stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+    }
+
+    void TiledLightCuller::workerLoop(int band) {
+        int generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(workMutex);
+                workReady.wait(lock, [&] { return stopping || workGeneration != generation; });
+                if (stopping) {
+                    return;
+                }
+                generation = workGeneration;
+            }
+            binBand(band);
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+                pendingWorkers--;
+                if (pendingWorkers == 0) {
+                    workDone.notify_one();
+                }
+            }
+        }
+    }
+
+    void TiledLightCuller::destroy() {
+        stopWorkers();
+        glDeleteTextures(1, &indexTexture);
+        glDeleteBuffers(1, &indexBuffer);
+        glDeleteTextures(1, &tilesTexture);
+        indexTexture = 0;
+        indexBuffer = 0;
+        tilesTexture = 0;
+        tilesTextureWidth = 0;
+        tilesTextureHeight = 0;
+        indexCapacity = 0;
+    }
+
+    // the range of one screen axis covered by a sphere, in normalized device coordinates
+    // (the angles of the two tangents from the eye, in the plane of the axis and the view direction)
+    static void projectSphereAxis(float center, float depth, float radius, float scale, float& minNdc, float& maxNdc) {
+        float distance = std::sqrt(center * center + depth * depth);
+        float direction = std::atan2(center, depth);
+        float halfAngle = std::asin(std::min(radius / distance, 1.0f));
+        const float rightAngle = 1.5707963f;
+        // the tangents reaching past the sides of the view are cut at a right angle
+        float minAngle = std::max(direction - halfAngle, -rightAngle);
+        float maxAngle = std::min(direction + halfAngle, rightAngle);
+        minNdc = minAngle <= -rightAngle ? -1.0f : scale * std::tan(minAngle);
+        maxNdc = maxAngle >= rightAngle ? 1.0f : scale * std::tan(maxAngle);
+    }
+
+    TiledLightCuller::TileRect TiledLightCuller::computeTileRect(const LightData& light, glm::mat4 projection, int width, int height) {
+        TileRect all = { 0, 0, tilesX - 1, tilesY - 1 };
+        TileRect none = { 0, 0, -1, -1 };
+        // see LightSource::computeRadius
+        float radius = light.parameters.z;
+        if (radius < 0.0f) {
+            return all;
+        }
+
+        // the camera looks towards -z; the near plane of the projection
+        glm::vec3 center = glm::vec3(light.position);
+        float near = projection[3][2] / (projection[2][2] - 1.0f);
+        if (center.z - radius > -near) {
+            // behind the camera
+            return none;
+        }
+        if (glm::length(center) <= radius) {
+            return all;
+        }
+
+        float minX, maxX, minY, maxY;
+        projectSphereAxis(center.x, -center.z, radius, projection[0][0], minX, maxX);
+        projectSphereAxis(center.y, -center.z, radius, projection[1][1], minY, maxY);
+        if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f) {
+            return none;
+        }
+        // close to a right angle the tangents are huge, they would overflow the pixel coordinates
+        minX = std::max(minX, -1.0f);
+        maxX = std::min(maxX, 1.0f);
+        minY = std::max(minY, -1.0f);
+        maxY = std::min(maxY, 1.0f);
+
+        TileRect rect;
+        rect.minX = std::max(0, (int)((minX * 0.5f + 0.5f) * width) / TILE_SIZE);
+        rect.maxX = std::min(tilesX - 1, (int)((maxX * 0.5f + 0.5f) * width) / TILE_SIZE);
+        rect.minY = std::max(0, (int)((minY * 0.5f + 0.5f) * height) / TILE_SIZE);
+        rect.maxY = std::min(tilesY - 1, (int)((maxY * 0.5f + 0.5f) * height) / TILE_SIZE);
+        return rect;
+    }
+
+    void TiledLightCuller::binRows(int firstRow, int lastRow) {
+        for (int tile = firstRow * tilesX; tile < lastRow * tilesX; tile++) {
+            tileLights[tile].clear();
+        }
+        // the lights are visited in order, the lists stay sorted
+        for (size_t i = 0; i < lightRects.size(); i++) {
+            const TileRect& rect = lightRects[i];
+            int minY = std::max(rect.minY, firstRow);
+            int maxY = std::min(rect.maxY, lastRow - 1);
+            for (int y = minY; y <= maxY; y++) {
+                for (int x = rect.minX; x <= rect.maxX; x++) {
+                    tileLights[y * tilesX + x].push_back((GLushort)i);
+                }
+            }
+        }
+    }
+
+    void TiledLightCuller::binBand(int band) {
+        int firstRow = band * rowsPerBand;
+        int lastRow = std::min(tilesY, firstRow + rowsPerBand);
+        if (firstRow < lastRow) {
+            binRows(firstRow, lastRow);
+        }
+    }
+
+    void TiledLightCuller::cull(const std::vector<LightData>& lights, glm::mat4 projection, int width, int height) {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        tileLights.resize(tilesX * tilesY);
+
+        lightRects.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++) {
+            lightRects[i] = computeTileRect(lights[i], projection, width, height);
+        }
+
+        if (workers.empty() || lights.size() < PARALLEL_MIN_LIGHTS || tilesY < threadCount * PARALLEL_MIN_ROWS_PER_THREAD) {
+            binRows(0, tilesY);
+            usedThreadCount = 1;
+        }
+        else {
+            // each thread fills its own band of rows, the lock only hands the work over
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+                rowsPerBand = (tilesY + threadCount - 1) / threadCount;
+                pendingWorkers = (int)workers.size();
+                workGeneration++;
+            }
+            workReady.notify_all();
+            binBand(0);
+            std::unique_lock<std::mutex> lock(workMutex);
+            workDone.wait(lock, [&] { return pendingWorkers == 0; });
+            usedThreadCount = threadCount;
+        }
+
+        tileRanges.resize(2 * tilesX * tilesY);
+        lightIndices.clear();
+        for (size_t tile = 0; tile < tileLights.size(); tile++) {
+            tileRanges[2 * tile] = (GLuint)lightIndices.size();
+            tileRanges[2 * tile + 1] = (GLuint)tileLights[tile].size();
+            lightIndices.insert(lightIndices.end(), tileLights[tile].begin(), tileLights[tile].end());
+        }
+
+        cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void TiledLightCuller::upload() {
+        if (tileRanges.empty()) {
+            return;
+        }
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.activeTexture(GL_TEXTURE0 + TILES_TEXTURE_UNIT);
+        stateCache.bindTexture(GL_TEXTURE_2D, tilesTexture);
+        if (tilesX != tilesTextureWidth || tilesY != tilesTextureHeight) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, tilesX, tilesY, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, &tileRanges[0]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            tilesTextureWidth = tilesX;
+            tilesTextureHeight = tilesY;
+        }
+        else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tilesX, tilesY, GL_RG_INTEGER, GL_UNSIGNED_INT, &tileRanges[0]);
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        if (lightIndices.size() > indexCapacity || indexCapacity == 0) {
+            // grown with some margin, the number of indices changes with the view
+            indexCapacity = std::max(lightIndices.size() + lightIndices.size() / 2, (size_t)1024);
+            glBufferData(GL_TEXTURE_BUFFER, indexCapacity * sizeof(GLushort), NULL, GL_DYNAMIC_DRAW);
+            stateCache.activeTexture(GL_TEXTURE0 + INDICES_TEXTURE_UNIT);
+            stateCache.bindTexture(GL_TEXTURE_BUFFER, indexTexture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, indexBuffer);
+        }
+        if (!lightIndices.empty()) {
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, lightIndices.size() * sizeof(GLushort), &lightIndices[0]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void TiledLightCuller::bind(gps::Shader shader) {
+        GLStateCache& stateCache = GLStateCache::getInstance();
+        stateCache.useProgram(shader.shaderProgram);
+        stateCache.activeTexture(GL_TEXTURE0 + TILES_TEXTURE_UNIT);
+        stateCache.bindTexture(GL_TEXTURE_2D, tilesTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "lightTiles"), TILES_TEXTURE_UNIT);
+        stateCache.activeTexture(GL_TEXTURE0 + INDICES_TEXTURE_UNIT);
+        stateCache.bindTexture(GL_TEXTURE_BUFFER, indexTexture);
+        glUniform1i(glGetUniformLocation(shader.shaderProgram, "lightIndices"), INDICES_TEXTURE_UNIT);
+    }
+
+    double TiledLightCuller::getCullMilliseconds() {
+        return cullMilliseconds;
+    }
+
+    void TiledLightCuller::printStats(std::ostream& out) {
+        size_t maxLights = 0;
+        for (size_t tile = 0; tile < tileLights.size(); tile++) {
+            maxLights = std::max(maxLights, tileLights[tile].size());
+        }
+        size_t tileCount = std::max(tileLights.size(), (size_t)1);
+        out << "Tiled light culling: " << tilesX << "x" << tilesY << " tiles, " << (double)lightIndices.size() / tileCount
+            << " light(s) per tile on average, " << maxLights << " at most, " << cullMilliseconds << " ms on "
+            << usedThreadCount << " of " << threadCount << " thread(s)" << std::endl;
+    }
+
+}
@@ -0,0 +1,107 @@
+#ifndef TiledLightCuller_hpp
+#define TiledLightCuller_hpp
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include "LightBuffer.hpp"
+#include "Shader.hpp"
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gps {
+
+// Bins the lights of the frame into screen tiles on the CPU, so the lighting shaders only loop over
+// the lights which can reach the pixels of their tile (TILED_LIGHTS permutation, see shaders/include/lights.glsl).
+// The bounding sphere of every light is projected to a rectangle of tiles, then the rows of tiles are
+// shared by the worker threads, which wait between the frames. Small frames are binned on the calling thread,
+// waking the workers would cost more than the binning. Needs no compute shaders, for the software and low-end GL drivers.
+// Two textures are produced: the offset and count of the lights of every tile (RG32UI, one texel per tile)
+// and the light indices of all the tiles one after the other (texture buffer, R16UI).
+class TiledLightCuller
+{
+public:
+    // size of the tiles in pixels (LIGHT_TILE_SIZE in shaders/include/options.glsl)
+    static const int TILE_SIZE = 16;
+    // texture units of the lightTiles and lightIndices samplers
+    static const GLuint TILES_TEXTURE_UNIT = 10;
+    static const GLuint INDICES_TEXTURE_UNIT = 11;
+    // threads binning the tiles, the calling one included
+    static const int MAX_THREADS = 4;
+
+    TiledLightCuller();
+    ~TiledLightCuller();
+
+    void init();
+    void destroy();
+
+    // lights - in eye space (see LightBuffer), indexed as in the light buffer;
+    // projection - of the camera, width and height - of the screen in pixels
+    void cull(const std::vector<LightData>& lights, glm::mat4 projection, int width, int height);
+    // sends the tiles of the last cull to the video memory
+    void upload();
+    // binds the textures to the lightTiles and lightIndices samplers of the program
+    void bind(gps::Shader shader);
+
+    // CPU time of the last cull
+    double getCullMilliseconds();
+    void printStats(std::ostream& out);
+
+private:
+    // tiles touched by a light, inclusive bounds; empty when minX > maxX
+    struct TileRect
+    {
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    TileRect computeTileRect(const LightData& light, glm::mat4 projection, int width, int height);
+    // fills the light lists of the tile rows [firstRow, lastRow)
+    void binRows(int firstRow, int lastRow);
+    // the rows of the band of the given thread, see rowsPerBand
+    void binBand(int band);
+    void workerLoop(int band);
+    void stopWorkers();
+
+    int tilesX;
+    int tilesY;
+    std::vector<TileRect> lightRects;
+    // kept from frame to frame, to reuse their memory
+    std::vector<std::vector<GLushort> > tileLights;
+    // offset and count of every tile in lightIndices
+    std::vector<GLuint> tileRanges;
+    std::vector<GLushort> lightIndices;
+
+    GLuint tilesTexture;
+    int tilesTextureWidth;
+    int tilesTextureHeight;
+    GLuint indexBuffer;
+    GLuint indexTexture;
+    size_t indexCapacity;
+
+    int threadCount;
+    // threads used by the last cull
+    int usedThreadCount;
+    double cullMilliseconds;
+
+    // the workers bin the bands 1 .. threadCount - 1 of every cull
+    std::vector<std::thread> workers;
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    // incremented for every cull given to the workers
+    int workGeneration;
+    int pendingWorkers;
+    int rowsPerBand;
+    bool stopping;
+};
+
+}
+
+#endif /* TiledLightCuller_hpp */
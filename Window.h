@@ -16,7 +16,9 @@ namespace gps {
     class Window {
 
     public:
-        void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        // a hidden window only provides the GL context (the benchmark renders into its own framebuffer), without vsync;
+        // it still needs a display, on a headless machine an X server such as Xvfb
+        void Create(int width=800, int height=600, const char *title="OpenGL Project", bool visible=true);
         void Delete();
 
         GLFWwindow* getWindow();
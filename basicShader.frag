@@ -1,59 +0,0 @@
-#version 410 core
-
-in vec3 fPosition;
-in vec3 fNormal;
-in vec2 fTexCoords;
-
-out vec4 fColor;
-
-//matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat3 normalMatrix;
-//lighting
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-// textures
-uniform sampler2D diffuseTexture;
-uniform sampler2D specularTexture;
-
-//components
-vec3 ambient;
-float ambientStrength;
-vec3 diffuse;
-vec3 specular;
-float specularStrength = 0.25f;
-
-void computeDirLight()
-{
-    //compute eye space coordinates
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 normalEye = normalize(normalMatrix * fNormal);
-
-    //normalize light direction
-    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
-
-    //compute view direction (in eye coordinates, the viewer is situated at the origin
-    vec3 viewDir = normalize(- fPosEye.xyz);
-
-    //compute ambient light
-    ambient = ambientStrength * lightColor;
-
-    //compute diffuse light
-    diffuse = max(dot(normalEye, lightDirN), 0.0f) * lightColor;
-
-    //compute specular light
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
-    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
-    specular = specularStrength * specCoeff * lightColor;
-}
-
-void main() 
-{
-    computeDirLight();
-
-    //compute final vertex color
-    vec3 color = min((ambient + diffuse) * texture(diffuseTexture, fTexCoords).rgb + specular * texture(specularTexture, fTexCoords).rgb, 1.0f);
-
-    fColor = vec4(color, 1.0f);
-}
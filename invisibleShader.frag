@@ -1,79 +0,0 @@
-#version 410 core
-
-in vec3 fPosition;
-in vec3 fNormal;
-in vec2 fTexCoords;
-in vec4 fragPosLightSpace;
-
-out vec4 fColor;
-
-//matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat3 normalMatrix;
-uniform vec3 cameraPos;
-
-//lighting
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-
-// textures
-uniform sampler2D diffuseTexture;
-uniform sampler2D specularTexture;
-uniform sampler2D shadowMap; 
-
-// skybox
-uniform samplerCube skybox;
-
-//components
-vec3 ambient;
-float ambientStrength = 0.2f;
-vec3 diffuse;
-vec3 specular;
-float specularStrength = 0.5f;
-float shininess = 32.0f;
-
-// environment mapping
-vec3 I;
-vec3 R;
-vec3 refractedColor;
-float refractionCoefficient = 1.52; 
-
-void computeDirLight()
-{
-    //compute eye space coordinates
-    vec4 fPosEye = view * model * vec4(fPosition, 1.0f);
-    vec3 normalEye = normalize(normalMatrix * fNormal);
-
-    //normalize light direction
-    vec3 lightDirN = vec3(normalize(view * vec4(lightDir, 0.0f)));
-
-    //compute view direction (in eye coordinates, the viewer is situated at the origin
-    vec3 viewDir = normalize(- fPosEye.xyz);
-
-    //compute ambient light
-    ambient = ambientStrength * lightColor;
-
-    //compute diffuse light
-    diffuse = max(dot(normalEye, lightDirN), 0.0f) * lightColor;
-
-    //compute specular light
-    vec3 reflectDir = reflect(-lightDirN, normalEye);
-    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
-    specular = specularStrength * specCoeff * lightColor;
-
-    float ratio = 1.00 / refractionCoefficient;
-    I = normalize(fPosition - cameraPos);
-    R = refract(normalize(fNormal), I, ratio);
-
-    refractedColor = texture(skybox, R).rgb;
-}
-
-void main() 
-{
-    computeDirLight();
-   
-    vec3 color = refractedColor;
-
-    fColor = vec4(color, 1.0f);
-}
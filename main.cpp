@@ -14,8 +14,27 @@
 #include "SkyBox.hpp"
 #include "Animation.hpp"
 #include "LightSource.hpp"
-
+#include "TextureResidency.hpp"
+#include "IndirectDrawBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "GLStateCache.hpp"
+#include "MaterialLibrary.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "ShaderBatch.hpp"
+#include "ShaderWatcher.hpp"
+#include "ShaderPermutationCache.hpp"
+#include "LightBuffer.hpp"
+#include "GpuTimer.hpp"
+#include "ShadowAtlas.hpp"
+#include "Frustum.hpp"
+#include "GBuffer.hpp"
+#include "TiledLightCuller.hpp"
+#include "DynamicResolution.hpp"
+#include "ScreenTriangle.hpp"
+
+#include <algorithm>
 #include <iostream>
+#include <random>
 
 // window
 gps::Window myWindow;
@@ -25,8 +44,20 @@ int retina_width = myWindowWidth;
 int retina_height = myWindowHeight;
 
 // shadow
-const unsigned int SHADOW_WIDTH = 2048;
-const unsigned int SHADOW_HEIGHT = 2048;
+// the filtered comparisons (PCF) give smooth edges at a lower resolution
+const unsigned int SHADOW_WIDTH = 1024;
+const unsigned int SHADOW_HEIGHT = 1024;
+// taps of the percentage-closer filter (PCF_TAPS permutation), F4 goes through them
+const int PCF_TAP_COUNTS[] = { 1, 4, 8, 16 };
+const int NO_PCF_TAP_COUNTS = 4;
+int pcfTapCountIndex = 2;
+// shadow maps of the spot, night and reflector lights
+gps::ShadowAtlas shadowAtlas;
+// light space transformation of the shadow map being rendered
+glm::mat4 depthPassTransformation;
+
+// texture memory budget
+const size_t TEXTURE_MEMORY_BUDGET = 128 * 1024 * 1024;
 
 // matrices
 glm::mat4 model;
@@ -79,6 +110,20 @@ glm::vec3 initialPointLightMiddlePosition = glm::vec3(0.0, LIGHT_HEIGHT, 0.0);
 glm::vec3 initialPointLightRightPosition = glm::vec3(20.0, LIGHT_HEIGHT, 1.0);
 
 const int NO_NIGHT_LIGHTS = 6;
+const int NO_REFLECTOR_LIGHTS = 4;
+
+// point lights scattered over the court, added to any lighting mode to measure the cost of many lights (F8)
+std::vector<LightSource> extraPointLights;
+const int EXTRA_LIGHT_COUNTS[] = { 0, 10, 100, 1000 };
+const int NO_EXTRA_LIGHT_COUNTS = 4;
+int extraLightCountIndex = 0;
+const glm::vec3 EXTRA_LIGHT_ATTENUATION = glm::vec3(1.0f, 0.14f, 0.07f);
+
+// attenuation (constant, linear, quadratic) of the lights and cosines of the outer cones
+const glm::vec3 SPOT_LIGHT_ATTENUATION = glm::vec3(0.2f, 0.00045f, 0.00045f);
+const glm::vec3 POINT_LIGHT_ATTENUATION = glm::vec3(0.2f, 0.0045f, 0.0035f);
+const float SPOT_LIGHT_OUTER_CONE = 0.45f;
+const float FLASH_LIGHT_OUTER_CONE = 0.99f;
 
 glm::vec3 nightLightPositions[NO_NIGHT_LIGHTS] = {
     glm::vec3(40.0, 28.0, -35.0),
@@ -112,38 +157,6 @@ glm::vec3 reflectorLightTargets[4] = {
         glm::vec3(69.0, 0.0, 3.0)
 };
 
-const char nightLightPositionsUniform[NO_NIGHT_LIGHTS][30] = {
-    "nightLightPosition0",
-    "nightLightPosition1",
-    "nightLightPosition2",
-    "nightLightPosition3",
-    "nightLightPosition4",
-    "nightLightPosition5"
-};
-
-const char nightLightTargetUniform[NO_NIGHT_LIGHTS][30] = {
-    "nightLightTarget0",
-    "nightLightTarget1",
-    "nightLightTarget2",
-    "nightLightTarget3",
-    "nightLightTarget4",
-    "nightLightTarget5",
-};
-
-const char reflectorLightPositionsUniform[4][30] = {
-    "reflectorLightPosition0",
-    "reflectorLightPosition1",
-    "reflectorLightPosition2",
-    "reflectorLightPosition3"
-};
-
-const char reflectorLightTargetsUniform[4][30] = {
-    "reflectorLightTarget0",
-    "reflectorLightTarget1",
-    "reflectorLightTarget2",
-    "reflectorLightTarget3",
-};
-
 const glm::vec3 WHITE_COLOUR = glm::vec3(1, 1, 1);
 
 const float MIN_CUT_OFF_ANGLE_FLASHLIGHTS = 1.0;
@@ -162,15 +175,61 @@ float animationSpeed = 5.0;
 Animation ballAnimation(ballInitialPosition, animationSpeed);
 
 // shaders
-gps::Shader basicShader;
+// lights the scene objects in every lighting mode, the modes only differ by the light buffer
+gps::Shader lightingShader;
 gps::Shader lightShader;
-gps::Shader nightLightsShader;
-gps::Shader flashLightShader;
-gps::Shader spotLightShader;
-gps::Shader pointLightsShader;
 gps::Shader depthMapShader;
 gps::Shader skyboxShader;
-
+// writes only the depths of the scene objects before the lighting pass
+gps::Shader depthPrepassShader;
+// counts the shaded fragments per pixel instead of lighting them
+gps::Shader overdrawShader;
+// deferred shading: the surfaces are written to the G-buffer, then lit once per pixel
+gps::Shader gBufferShader;
+gps::Shader deferredLightingShader;
+// stretches the scene rendered at a lower resolution over the screen
+gps::Shader upscaleShader;
+// the shaders are compiled while the models are loaded
+gps::ShaderBatch shaderBatch;
+// recompiles the shaders edited while the application runs
+gps::ShaderWatcher shaderWatcher;
+// the lighting shader samples the shadow map (SHADOWS permutation) and the shadow pass is rendered
+bool shadowsEnabled = true;
+// the eye space position and normal are computed per vertex (VERTEX_EYE_SPACE permutation)
+bool vertexEyeSpace = true;
+// the depths are laid down first, so the lighting shader runs once per pixel (GL_EQUAL test);
+// only with many lights, when shading a hidden fragment costs more than drawing the scene twice
+bool depthPrepassEnabled = true;
+const int DEPTH_PREPASS_MIN_LIGHTS = 4;
+// the scene is drawn with the overdraw shader, brighter where more fragments are shaded
+bool showOverdraw = false;
+// lighting by deferred shading instead of the forward lighting shader (F7)
+bool deferredShading = false;
+gps::GBuffer gBuffer;
+// the lighting shaders only compute the lights binned into the screen tile of the fragment (F9)
+bool tiledLightCulling = true;
+gps::TiledLightCuller lightCuller;
+// the lights out of the view frustum or out of range are not sent to the shaders (F10)
+bool lightRangeCulling = true;
+// the scene is rendered at a lower resolution when the frames take longer than the target (F11)
+gps::DynamicResolution dynamicResolution;
+
+// --benchmark: renders a fixed number of frames and prints the GPU times; the frames are drawn into
+// an application framebuffer of the window size, the hidden window only provides the context,
+// so a display is still required (on a headless machine run it under Xvfb: xvfb-run <executable> --benchmark)
+bool benchmarkMode = false;
+const int BENCHMARK_WARMUP_FRAMES = 20;
+const int BENCHMARK_FRAMES = 200;
+// GPU time of the lighting pass (with its depth pre-pass)
+gps::GpuTimer lightingPassTimer;
+// samples shaded by the lighting pass
+gps::GpuTimer shadedSamplesCounter(GL_SAMPLES_PASSED);
+// target of the benchmark frames, multisampled like the window
+GLuint benchmarkFramebuffer = 0;
+GLuint benchmarkColorRenderbuffer = 0;
+GLuint benchmarkDepthRenderbuffer = 0;
+
+// lighting mode, selects the lights put into the light buffer
 enum SHADER_TYPE { BASIC, FLASH_LIGHT, SPOT_LIGHT, POINT_LIGHTS, NIGHT_LIGHTS };
 SHADER_TYPE currentShader = BASIC;
 
@@ -181,13 +240,8 @@ GLint modelLoc;
 GLint viewLoc;
 GLint projectionLoc;
 GLint normalMatrixLoc;
-GLint lightDirLoc;
-GLint lightColorLoc;
-GLint lightPositionLoc;
-GLint cutOffAngleLoc;
 GLint shininessLoc;
 GLint cameraPosLoc;
-GLint spotLightTargetLoc;
 
 // camera
 gps::Camera myCamera(
@@ -218,6 +272,12 @@ gps::Model3D middleLight;
 gps::Model3D leftLight;
 gps::Model3D rightLight;
 
+// draws of the scene objects, sorted by state, and their commands rebuilt every frame
+gps::RenderQueue renderQueue;
+gps::IndirectDrawBuffer sceneDrawCommands;
+// lights of the current lighting mode, read by the lighting shader
+gps::LightBuffer lightBuffer;
+
 // skybox
 std::vector<const GLchar*> faces;
 gps::SkyBox mySkyBox;
@@ -243,6 +303,8 @@ void initOpenGLState();
 void initModels();
 void initAnimations();
 void initShaders();
+void finishShaders();
+void reloadShaders();
 void initUniforms();
 void initUniformsForShader(gps::Shader shader);
 void initLightSources();
@@ -257,20 +319,34 @@ void processCameraMovement();
 
 // select a shader
 void selectShader();
+gps::Shader* getSelectedShader();
+gps::Shader* getShaderPermutation(gps::Shader* shader, gps::ShaderDefines defines);
 // select a light source to animate
 void selectLightSource();
+// fills the light buffer with the lights of the current mode
+void updateLights();
+// adds a spot light and requests its shadow map from the atlas (index in the light buffer, request of the atlas)
+void addSpotLightWithShadow(LightSource* light, float cutOffAngle, std::vector<std::pair<size_t, size_t> >& atlasShadows);
+// fraction of the screen height lit by a spot light, 0 if its light is not visible
+float getShadowCoverage(LightSource* light);
 
 // functions for updating the transformation matrices after the camera or the object has moved
 void updateUniforms(gps::Shader shader, glm::mat4 model, bool depthPass);
 void updateCommonUniformsForShader(gps::Shader shader, glm::mat4 model);
 glm::mat4 getSceneTransformation();
+glm::mat4 getClipTransformation(glm::mat4 model, bool depthPass);
 glm::mat4 getModelForDrawingLightCube(LightSource* lightSource);
+glm::mat4 getBallTransformation();
 glm::mat4 getModelForDrawingNightLight(glm::vec3 lightPosition);
 void rotateCamera(float xOffset, float yOffset);
 
 // render scene of objects
 void renderScene();
-void drawObjects(gps::Shader shader, bool depthPass);
+void drawObjects(gps::Shader shader, gps::RenderPass pass);
+void drawForward(gps::Shader shader);
+void drawDeferred(gps::Shader shader);
+bool isDepthPrepassUsed();
+double getShadedFragmentsPerPixel();
 
 // callback functions for handling user interactions
 void windowResizeCallback(GLFWwindow* window, int width, int height);
@@ -279,11 +355,24 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void mousButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
+// compares the lighting pass of the permutations, in every lighting mode
+void runBenchmark();
+void initBenchmarkFramebuffer(int width, int height);
+void destroyBenchmarkFramebuffer();
+// average GPU time of the lighting pass, in milliseconds
+double measureLightingPass();
+
 // clean-up
 void cleanup();
 
 int main(int argc, const char* argv[]) {
 
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--benchmark") {
+            benchmarkMode = true;
+        }
+    }
+
     try {
         initOpenGLWindow();
     }
@@ -295,18 +384,28 @@ int main(int argc, const char* argv[]) {
     initOpenGLState();
     initShaders();
     initModels();
+    // the programs compiled while the models were loaded
+    shaderBatch.finishCompleted();
     initSkyBox();
     initFBO();
+    finishShaders();
     initAnimations();
     initLightSources();
     initUniforms();
     setWindowCallbacks();
 
     glCheckError();
+    if (benchmarkMode) {
+        runBenchmark();
+        cleanup();
+        return EXIT_SUCCESS;
+    }
+
     // application loop
     while (!glfwWindowShouldClose(myWindow.getWindow())) {
         processMovement();
         selectShader();
+        reloadShaders();
         renderScene();
 
         glfwPollEvents();
@@ -320,33 +419,55 @@ int main(int argc, const char* argv[]) {
     return EXIT_SUCCESS;
 }
 
+gps::Shader* getSelectedShader() {
+    // the lighting modes do not need different programs
+    gps::Shader* shader = deferredShading ? &deferredLightingShader : &lightingShader;
+    gps::ShaderDefines defines = shader->getDefines();
+    defines["SHADOWS"] = shadowsEnabled ? "1" : "0";
+    defines["PCF_TAPS"] = std::to_string(PCF_TAP_COUNTS[pcfTapCountIndex]);
+    defines["TILED_LIGHTS"] = tiledLightCulling ? "1" : "0";
+    if (!deferredShading) {
+        // the deferred shading reads the eye space positions from the G-buffer
+        defines["VERTEX_EYE_SPACE"] = vertexEyeSpace ? "1" : "0";
+    }
+    if (defines == shader->getDefines()) {
+        return shader;
+    }
+    return getShaderPermutation(shader, defines);
+}
+
+gps::Shader* getShaderPermutation(gps::Shader* shader, gps::ShaderDefines defines) {
+    bool created = false;
+    gps::Shader* permutation = gps::ShaderPermutationCache::getInstance().get(
+        shader->getVertexShaderFileName(), shader->getFragmentShaderFileName(), defines, &created);
+    if (created) {
+        shaderWatcher.watch(permutation);
+    }
+    return permutation;
+}
+
 void selectShader() {
     if (pressedKeys[GLFW_KEY_1]) {
         currentShader = BASIC;
         daylightIntensity = 1.0f;
         selectedLight = directionalLight;
-        initUniformsForShader(basicShader);
     }
     if (pressedKeys[GLFW_KEY_2]) {
         currentShader = NIGHT_LIGHTS;
         daylightIntensity = 0.01f;
-        initUniformsForShader(nightLightsShader);
     }
     if (pressedKeys[GLFW_KEY_3]) {
         currentShader = FLASH_LIGHT;
         selectedLight = flashLight;
-        initUniformsForShader(flashLightShader);
     }
     if (pressedKeys[GLFW_KEY_4]) {
         currentShader = SPOT_LIGHT;
         daylightIntensity = 0.01f;
         selectedLight = spotLight;
-        initUniformsForShader(spotLightShader);
     }
     if (pressedKeys[GLFW_KEY_5]) {
         currentShader = POINT_LIGHTS;
         daylightIntensity = 0.01f;
-        initUniformsForShader(pointLightsShader);
     }
 }
 
@@ -436,12 +557,10 @@ void processLightMovement() {
 
         if (daylightIntensity < 0.5) {
             currentShader = NIGHT_LIGHTS;
-            initUniformsForShader(nightLightsShader);
         }
         else if (daylightIntensity >= 0.5) {
             currentShader = BASIC;
             selectedLight = directionalLight;
-            initUniformsForShader(basicShader);
         }
     }
     
@@ -563,7 +682,7 @@ void updateUniforms(gps::Shader shader, glm::mat4 model, bool depthPass) {
     glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
     // do not send the other matrices to the depth map shader
     if (depthPass) {
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(directionalLight->computeLightSpaceTrMatrixDirectionalLight()));
+        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(depthPassTransformation));
         return;
     }
     //update view matrix
@@ -580,50 +699,99 @@ void updateUniforms(gps::Shader shader, glm::mat4 model, bool depthPass) {
     // send the camera's position to shader
     glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "cameraPos"), 1, GL_FALSE, glm::value_ptr(myCamera.getCameraPosition()));
 
-    // update the light sources
+    // shadows of the directional and flash lights
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(directionalLight->computeLightSpaceTrMatrixDirectionalLight()));
+}
 
+void updateLights() {
     // flashlight is attached to the front of the camera
     flashLight->setLightPosition(myCamera.getCameraPosition());
     // the flashlight is oriented towards the camera's viewing (front) direction
     flashLight->setLightTarget(myCamera.getCameraFrontDirection());
     // the spot light should follow the ball's movement
     spotLight->setLightTarget(ballAnimation.getCurrentPosition());
-    
+
+    // the lights are sent in eye space, the shaders do not transform them
+    lightBuffer.setViewMatrix(myCamera.getViewMatrix(), getSceneTransformation());
+    lightBuffer.setProjection(glm::perspective(glm::radians(fov), (float)retina_width / (float)retina_height, 0.1f, 1000.0f));
+    lightBuffer.setCulling(lightRangeCulling);
+    lightBuffer.clear();
+    shadowAtlas.beginFrame();
+    // the ball is the only object which moves, the tiles of the lights it shadows are updated every frame
+    glm::vec3 ballBoundsMin, ballBoundsMax;
+    basketBall.getBounds(ballBoundsMin, ballBoundsMax);
+    shadowAtlas.addMovingCaster(&basketBall, getBallTransformation(), ballBoundsMin, ballBoundsMax);
+    std::vector<std::pair<size_t, size_t> > atlasShadows;
     switch (currentShader) {
         case BASIC: {
-            glUniform3fv(lightDirLoc, 1, glm::value_ptr(directionalLight->getLightPosition()));
-            glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "lightSpaceTrMatrix"), 1, GL_FALSE, glm::value_ptr(directionalLight->computeLightSpaceTrMatrixDirectionalLight()));
+            lightBuffer.addDirectionalLight(directionalLight, true);
             break;
         }
-        case SPOT_LIGHT: {
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightPosition"), 1, glm::value_ptr(spotLight->getLightPosition()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "spotLightTarget"), 1, glm::value_ptr(spotLight->getLightTarget()));
-            glUniform1f(glGetUniformLocation(shader.shaderProgram, "cutOffAngle"), cos(glm::radians(spotLightsCutOffAngle)));
+        case FLASH_LIGHT: {
+            lightBuffer.addFlashLight(flashLight, cos(glm::radians(flashLightsCutOffAngle)), FLASH_LIGHT_OUTER_CONE);
             break;
         }
-        case FLASH_LIGHT: {
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "lightPosition"), 1, glm::value_ptr(flashLight->getLightPosition()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "spotLightTarget"), 1, glm::value_ptr(flashLight->getLightTarget()));
-            glUniform1f(glGetUniformLocation(shader.shaderProgram, "cutOffAngle"), cos(glm::radians(flashLightsCutOffAngle)));
+        case SPOT_LIGHT: {
+            addSpotLightWithShadow(spotLight, spotLightsCutOffAngle, atlasShadows);
             break;
         }
         case NIGHT_LIGHTS: {
-            glUniform1f(glGetUniformLocation(shader.shaderProgram, "ambientStrength"), daylightIntensity);
+            for (int i = 0; i < NO_NIGHT_LIGHTS; i++) {
+                addSpotLightWithShadow(nightLights[i], nightLightsCutOffAngle, atlasShadows);
+            }
+            for (int i = 0; i < NO_REFLECTOR_LIGHTS; i++) {
+                addSpotLightWithShadow(reflectorLights[i], nightLightsCutOffAngle, atlasShadows);
+            }
             break;
         }
         case POINT_LIGHTS: {
-            // send point light dir and color to shader
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "leftPointLightColor"), 1, glm::value_ptr(pointLightLeft->getLightColor()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "rightPointLightColor"), 1, glm::value_ptr(pointLightRight->getLightColor()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "middlePointLightColor"), 1, glm::value_ptr(pointLightMiddle->getLightColor()));
-
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "leftPointLightPosition"), 1, glm::value_ptr(pointLightLeft->getLightPosition()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "rightPointLightPosition"), 1, glm::value_ptr(pointLightRight->getLightPosition()));
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, "middlePointLightPosition"), 1, glm::value_ptr(pointLightMiddle->getLightPosition()));
+            lightBuffer.addPointLight(pointLightMiddle);
+            lightBuffer.addPointLight(pointLightLeft);
+            lightBuffer.addPointLight(pointLightRight);
             break;
         }
     }
-    
+    for (int i = 0; i < EXTRA_LIGHT_COUNTS[extraLightCountIndex]; i++) {
+        lightBuffer.addPointLight(&extraPointLights[i]);
+    }
+
+    // sizes and places of the shadow maps, then their tiles are given to the lights
+    shadowAtlas.allocate();
+    for (size_t i = 0; i < atlasShadows.size(); i++) {
+        size_t request = atlasShadows[i].second;
+        if (shadowAtlas.getTile(request).size > 0) {
+            lightBuffer.setAtlasShadow(atlasShadows[i].first, shadowAtlas.getLightSpaceTrMatrix(request), shadowAtlas.getTextureRect(request));
+        }
+    }
+    // only sent when the lights changed
+    lightBuffer.upload();
+}
+
+void addSpotLightWithShadow(LightSource* light, float cutOffAngle, std::vector<std::pair<size_t, size_t> >& atlasShadows) {
+    size_t lightIndex = lightBuffer.addSpotLight(light, cos(glm::radians(cutOffAngle)), SPOT_LIGHT_OUTER_CONE);
+    // a culled light needs no shadow map
+    if (!shadowsEnabled || lightIndex == gps::LightBuffer::NO_LIGHT) {
+        return;
+    }
+    // the shadow map covers the outer cone
+    glm::mat4 lightSpaceTrMatrix = light->computeLightSpaceTrMatrixSpotLight(getSceneTransformation(), glm::degrees(acos(SPOT_LIGHT_OUTER_CONE)));
+    atlasShadows.push_back(std::make_pair(lightIndex, shadowAtlas.request(light, lightSpaceTrMatrix, getShadowCoverage(light))));
+}
+
+float getShadowCoverage(LightSource* light) {
+    // the lit area is approximated by the sphere around the target reached by the outer cone
+    glm::mat4 sceneTransformation = getSceneTransformation();
+    glm::vec3 position = glm::vec3(sceneTransformation * glm::vec4(light->getLightPosition(), 1.0f));
+    glm::vec3 target = glm::vec3(sceneTransformation * glm::vec4(light->getLightTarget(), 1.0f));
+    float radius = glm::length(target - position) * tan(acos(SPOT_LIGHT_OUTER_CONE));
+
+    glm::mat4 cameraView = myCamera.getViewMatrix();
+    if (!gps::Frustum(projection * cameraView).intersectsSphere(target, radius)) {
+        return 0.0f;
+    }
+    // projected size of the sphere, relative to the height of the view at its distance
+    float distance = glm::max(-(cameraView * glm::vec4(target, 1.0f)).z, radius);
+    return glm::min(radius / (distance * (float)tan(glm::radians(fov) / 2.0f)), 1.0f);
 }
 
 void updateCommonUniformsForShader(gps::Shader shader, glm::mat4 model) {
@@ -659,20 +827,39 @@ glm::mat4 getSceneTransformation() {
     return sceneTransformation;
 }
 
-void drawObjects(gps::Shader shader, bool depthPass) {
+// transforms from object space to the clip space of the current pass, for frustum culling
+glm::mat4 getClipTransformation(glm::mat4 model, bool depthPass) {
+    if (depthPass) {
+        return depthPassTransformation * model;
+    }
+    return projection * view * model;
+}
+
+glm::mat4 getBallTransformation() {
+    glm::mat4 ballTransformation = ballAnimation.getTransformationMatrix();
+    // a ball held by the player follows the camera, not the scene
+    if (!ballAnimation.isBallPickedUp() || ballAnimation.isAnimationPlaying()) {
+        ballTransformation = ballTransformation * getSceneTransformation();
+    }
+    return ballTransformation;
+}
+
+void drawObjects(gps::Shader shader, gps::RenderPass pass) {
     shader.useShaderProgram();
+    // the shadow pass renders from the light, the other passes from the camera
+    bool depthPass = pass == gps::RENDER_PASS_SHADOW;
  
     model = getSceneTransformation();
     // draw ball
-    glm::mat4 ballTransformation = ballAnimation.getTransformationMatrix();
-    if (!ballAnimation.isBallPickedUp() || ballAnimation.isAnimationPlaying()) {
-        ballTransformation = ballTransformation * model;
-    }
-    updateUniforms(shader, ballTransformation, depthPass);
-    basketBall.Draw(shader);
+    glm::mat4 ballTransformation = getBallTransformation();
+    // the per object uniforms are set by the render queue
     updateUniforms(shader, model, depthPass);
+    basketBall.Enqueue(renderQueue, pass, shader, ballTransformation,
+        glm::mat3(glm::inverseTranspose(view * ballTransformation)), getClipTransformation(ballTransformation, depthPass));
     // draw the basketball court
-    basketBallCourt.Draw(shader);
+    basketBallCourt.Enqueue(renderQueue, pass, shader, model,
+        glm::mat3(glm::inverseTranspose(view * model)), getClipTransformation(model, depthPass));
+    renderQueue.submit(sceneDrawCommands);
 }
 
 void drawLightSources(gps::Shader shader) {
@@ -719,62 +906,143 @@ void drawLightSources(gps::Shader shader) {
     }
 }
 
+// lights the objects while drawing them, all the lights for every fragment
+void drawForward(gps::Shader shader) {
+    bool depthPrepass = isDepthPrepassUsed();
+    if (depthPrepass) {
+        // only the visible fragments pass the GL_EQUAL test of the lighting pass
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawObjects(depthPrepassShader, gps::RENDER_PASS_DEPTH_PREPASS);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        gps::GLStateCache::getInstance().depthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    shadedSamplesCounter.begin();
+    if (showOverdraw) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        drawObjects(overdrawShader, gps::RENDER_PASS_OPAQUE);
+        glDisable(GL_BLEND);
+    }
+    else {
+        drawObjects(shader, gps::RENDER_PASS_OPAQUE);
+    }
+    shadedSamplesCounter.end();
+
+    if (depthPrepass) {
+        gps::GLStateCache::getInstance().depthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+// writes the surfaces of the objects to the G-buffer, then lights every pixel once
+void drawDeferred(gps::Shader shader) {
+    gBuffer.resize(retina_width, retina_height);
+    gBuffer.beginGeometryPass();
+    drawObjects(gBufferShader, gps::RENDER_PASS_OPAQUE);
+    gBuffer.endGeometryPass(dynamicResolution.getSceneFramebuffer());
+
+    shader.useShaderProgram();
+    gps::MaterialLibrary::getInstance().bindTable(shader);
+    gBuffer.bindTextures(shader);
+    // the G-buffer has the size of the screen, the scene may use a part of it
+    glUniform2f(glGetUniformLocation(shader.shaderProgram, "viewportSize"), (float)dynamicResolution.getRenderWidth(), (float)dynamicResolution.getRenderHeight());
+    // the view and projection of the frame, set by drawObjects
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+    glm::mat4 eyeToLightSpace = directionalLight->computeLightSpaceTrMatrixDirectionalLight() * glm::inverse(view);
+    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "eyeToLightSpace"), 1, GL_FALSE, glm::value_ptr(eyeToLightSpace));
+
+    // the shader writes the depths of the G-buffer, for the light cubes and the skybox drawn next
+    gps::GLStateCache::getInstance().depthFunc(GL_ALWAYS);
+    shadedSamplesCounter.begin();
+    gps::ScreenTriangle::getInstance().draw();
+    shadedSamplesCounter.end();
+    gps::GLStateCache::getInstance().depthFunc(GL_LESS);
+}
+
 void renderScene() {
     // update time variables after rendering the each frame, to create a uniform camera movement 
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
+    // the GPU time of the whole frame drives the resolution of the scene
+    dynamicResolution.beginFrame();
+
+    // keep the textures within the memory budget
+    gps::TextureResidency::getInstance().beginFrame();
+    // the scene objects are culled and their draw commands rebuilt for every pass
+    sceneDrawCommands.beginFrame();
+    gps::GLStateCache::getInstance().beginFrame();
+
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
-    //render the scene to the depth buffer 
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // the lights of the current mode, and the tiles of their shadow maps
+    updateLights();
 
-    drawObjects(depthMapShader, true);
+    //render the scene to the depth buffer, only for the directional light
+    if (shadowsEnabled && currentShader == BASIC) {
+        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glClear(GL_DEPTH_BUFFER_BIT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        depthPassTransformation = directionalLight->computeLightSpaceTrMatrixDirectionalLight();
+        drawObjects(depthMapShader, gps::RENDER_PASS_SHADOW);
 
-    // final scene rendering pass (with shadows)
-    glViewport(0, 0, retina_width, retina_height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
 
-    gps::Shader selectedShader = basicShader;
-    switch (currentShader) {
-        case BASIC: {
-            selectedShader = basicShader;
-            break;
-        }
-        case FLASH_LIGHT: {
-            selectedShader = flashLightShader;
-            break;
-        }
-        case SPOT_LIGHT: {
-            selectedShader = spotLightShader;
-            break;
-        }
-        case NIGHT_LIGHTS: {
-            selectedShader = nightLightsShader;
-            break;
-        }
-        case POINT_LIGHTS: {
-            selectedShader = pointLightsShader;
-            break;
+    // the shadow maps of the spot lights which are out of date
+    if (shadowAtlas.getRequestCount() > 0) {
+        shadowAtlas.beginRendering();
+        for (size_t i = 0; i < shadowAtlas.getRequestCount(); i++) {
+            if (!shadowAtlas.needsRendering(i)) {
+                continue;
+            }
+            shadowAtlas.beginTile(i);
+            depthPassTransformation = shadowAtlas.getLightSpaceTrMatrix(i);
+            drawObjects(depthMapShader, gps::RENDER_PASS_SHADOW);
         }
+        shadowAtlas.endRendering();
     }
-    
-    //bind the shadow map
+
+    // final scene rendering pass (with shadows), at the resolution chosen for this frame
+    dynamicResolution.resize(retina_width, retina_height);
+    dynamicResolution.beginScene();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    gps::Shader selectedShader = *getSelectedShader();
+    lightBuffer.bind(selectedShader);
+    if (tiledLightCulling) {
+        // the lights reaching every tile of the screen, seen with the projection of this frame
+        projection = glm::perspective(glm::radians(fov), (float)retina_width / (float)retina_height, 0.1f, 1000.0f);
+        lightCuller.cull(lightBuffer.getLights(), projection, dynamicResolution.getRenderWidth(), dynamicResolution.getRenderHeight());
+        lightCuller.upload();
+        lightCuller.bind(selectedShader);
+    }
+
+    //bind the shadow maps
     selectedShader.useShaderProgram();
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+    gps::GLStateCache::getInstance().activeTexture(GL_TEXTURE3);
+    gps::GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, depthMapTexture);
     glUniform1i(glGetUniformLocation(selectedShader.shaderProgram, "shadowMap"), 3);
+    gps::GLStateCache::getInstance().activeTexture(GL_TEXTURE4);
+    gps::GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, shadowAtlas.getTexture());
+    glUniform1i(glGetUniformLocation(selectedShader.shaderProgram, "shadowAtlas"), 4);
 
     // draw the objects with the currently seleted shader
-    drawObjects(selectedShader, false);
+    lightingPassTimer.begin();
+    if (deferredShading) {
+        drawDeferred(selectedShader);
+    }
+    else {
+        drawForward(selectedShader);
+    }
+    lightingPassTimer.end();
 
     //draw a white cube around each light
     drawLightSources(lightShader);
@@ -783,15 +1051,23 @@ void renderScene() {
     skyboxShader.useShaderProgram();
     glUniform1f(glGetUniformLocation(skyboxShader.shaderProgram, "ambientStrength"), daylightIntensity);
     mySkyBox.Draw(skyboxShader, view, projection);
+
+    dynamicResolution.endScene(upscaleShader);
+    dynamicResolution.endFrame();
 }
 
 void initModels() {
-    basketBall.LoadModel("models/basketball/basketball.obj", "models/basketball/");
-    basketBallCourt.LoadModel("models/basketball_court_outdoor/basketball_court.obj", "models/basketball_court_outdoor/");
+    gps::TextureResidency::getInstance().setBudget(TEXTURE_MEMORY_BUDGET);
+    // the large models use the compact (quantized) vertex layout
+    basketBall.LoadModel("models/basketball/basketball.obj", "models/basketball/", gps::VERTEX_FORMAT_COMPACT);
+    basketBallCourt.LoadModel("models/basketball_court_outdoor/basketball_court.obj", "models/basketball_court_outdoor/", gps::VERTEX_FORMAT_COMPACT);
     lightCube.LoadModel("models/cube/cube.obj");
     leftLight.LoadModel("models/cube/cube.obj");
     rightLight.LoadModel("models/cube/cube.obj");
     middleLight.LoadModel("models/cube/cube.obj");
+    // pack the textures of all the models into texture arrays
+    gps::MaterialLibrary::getInstance().build();
+    sceneDrawCommands.init(256);
 }
 
 void initAnimations() {
@@ -801,30 +1077,89 @@ void initAnimations() {
 }
 
 void initShaders() {
-    basicShader.loadShader(
-        "shaders/shadowShader.vert",
-        "shaders/shadowShader.frag");
-    lightShader.loadShader(
+    // the permutations are selected by the defines, see shaders/include/options.glsl
+    gps::ShaderDefines lightingDefines;
+    lightingDefines["SHADOWS"] = "1";
+    lightingDefines["VERTEX_EYE_SPACE"] = "1";
+    lightingDefines["PCF_TAPS"] = std::to_string(PCF_TAP_COUNTS[pcfTapCountIndex]);
+    lightingDefines["TILED_LIGHTS"] = "1";
+
+    shaderBatch.add(&lightingShader,
+        "shaders/lightingShader.vert",
+        "shaders/lightingShader.frag",
+        lightingDefines);
+    shaderBatch.add(&lightShader,
         "shaders/lightShader.vert",
         "shaders/lightShader.frag");
-    depthMapShader.loadShader(
+    shaderBatch.add(&depthMapShader,
         "shaders/depthMapShader.vert",
         "shaders/depthMapShader.frag");
-    skyboxShader.loadShader(
+    shaderBatch.add(&skyboxShader,
         "shaders/skyboxShader.vert",
         "shaders/skyboxShader.frag");
-    flashLightShader.loadShader(
-        "shaders/flashLightShader.vert",
-        "shaders/flashLightShader.frag");
-    spotLightShader.loadShader(
-        "shaders/spotLightShader.vert",
-        "shaders/spotLightShader.frag");
-    nightLightsShader.loadShader(
-        "shaders/nightLightShader.vert",
-        "shaders/nightLightShader.frag");
-    pointLightsShader.loadShader(
-        "shaders/pointLightsShader.vert",
-        "shaders/pointLightsShader.frag");
+    shaderBatch.add(&depthPrepassShader,
+        "shaders/depthPrepassShader.vert",
+        "shaders/depthPrepassShader.frag");
+    // the same vertex shader, so the overdraw is measured with the same depths
+    shaderBatch.add(&overdrawShader,
+        "shaders/depthPrepassShader.vert",
+        "shaders/overdrawShader.frag");
+    // the vertex shader of the lighting shader, without the shadow coordinates
+    gps::ShaderDefines gBufferDefines;
+    gBufferDefines["SHADOWS"] = "0";
+    gBufferDefines["VERTEX_EYE_SPACE"] = "1";
+    shaderBatch.add(&gBufferShader,
+        "shaders/lightingShader.vert",
+        "shaders/gBufferShader.frag",
+        gBufferDefines);
+    gps::ShaderDefines deferredLightingDefines;
+    deferredLightingDefines["SHADOWS"] = "1";
+    deferredLightingDefines["PCF_TAPS"] = lightingDefines["PCF_TAPS"];
+    deferredLightingDefines["TILED_LIGHTS"] = "1";
+    shaderBatch.add(&deferredLightingShader,
+        "shaders/screenTriangle.vert",
+        "shaders/deferredLightingShader.frag",
+        deferredLightingDefines);
+    shaderBatch.add(&upscaleShader,
+        "shaders/screenTriangle.vert",
+        "shaders/upscaleShader.frag");
+    shaderBatch.submit();
+}
+
+void finishShaders() {
+    shaderBatch.finish();
+    // compile vs cache-hit time of the startup
+    gps::ProgramBinaryCache::getInstance().printStats(std::cout);
+
+    // reload the shaders when their files are edited
+    gps::Shader* watchedShaders[] = { &lightingShader, &lightShader, &depthMapShader, &skyboxShader, &depthPrepassShader, &overdrawShader,
+        &gBufferShader, &deferredLightingShader, &upscaleShader };
+    for (int i = 0; i < 9; i++) {
+        shaderWatcher.watch(watchedShaders[i]);
+        // shared with the permutations requested later
+        gps::ShaderPermutationCache::getInstance().add(watchedShaders[i]);
+    }
+    shaderWatcher.start();
+}
+
+void reloadShaders() {
+    std::vector<gps::Shader*> reloadedShaders = shaderWatcher.update();
+    for (size_t i = 0; i < reloadedShaders.size(); i++) {
+        gps::Shader* shader = reloadedShaders[i];
+        // the uniforms which are not sent every frame
+        if (shader == getSelectedShader()) {
+            initUniformsForShader(*shader);
+        }
+        else if (shader == &lightShader) {
+            lightShader.useShaderProgram();
+            glUniformMatrix4fv(glGetUniformLocation(lightShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        }
+        else if (shader == &skyboxShader) {
+            skyboxShader.useShaderProgram();
+            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        }
+    }
 }
 
 void initUniformsForShader(gps::Shader shader) {
@@ -854,73 +1189,12 @@ void initUniformsForShader(gps::Shader shader) {
 
     glUniformMatrix3fv(glGetUniformLocation(shader.shaderProgram, "cameraPos"), 1, GL_FALSE, glm::value_ptr(myCamera.getCameraPosition()));
 
-    if (currentShader == POINT_LIGHTS) {
-        // send light dir to shader
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "leftPointLightColor"), 1, glm::value_ptr(pointLightLeft->getLightColor()));
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "rightPointLightColor"), 1, glm::value_ptr(pointLightRight->getLightColor()));
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "middlePointLightColor"), 1, glm::value_ptr(pointLightMiddle->getLightColor()));
-
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "leftPointLightPosition"), 1, glm::value_ptr(pointLightLeft->getLightPosition()));
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "rightPointLightPosition"), 1, glm::value_ptr(pointLightRight->getLightPosition()));
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "middlePointLightPosition"), 1, glm::value_ptr(pointLightMiddle->getLightPosition()));
-        
-        return;
-    }
-
-    // send light color to shader
-    lightColorLoc = glGetUniformLocation(shader.shaderProgram, "lightColor");
-    glUniform3fv(lightColorLoc, 1, glm::value_ptr(directionalLight->getLightColor()));
-
-    if (currentShader == FLASH_LIGHT) {
-        lightPositionLoc = glGetUniformLocation(shader.shaderProgram, "lightPosition");
-        glUniform3fv(lightPositionLoc, 1, glm::value_ptr(flashLight->getLightPosition()));
-
-        spotLightTargetLoc = glGetUniformLocation(shader.shaderProgram, "spotLightTarget");
-        glUniform3fv(spotLightTargetLoc, 1, glm::value_ptr(flashLight->getLightTarget()));
-
-        cutOffAngleLoc = glGetUniformLocation(shader.shaderProgram, "cutOffAngle");
-        glUniform1f(cutOffAngleLoc, cos(glm::radians(flashLightsCutOffAngle)));
-    }
-    else if (currentShader == SPOT_LIGHT) {
-        lightPositionLoc = glGetUniformLocation(shader.shaderProgram, "lightPosition");
-        glUniform3fv(lightPositionLoc, 1, glm::value_ptr(spotLight->getLightPosition()));
-
-        spotLightTargetLoc = glGetUniformLocation(shader.shaderProgram, "spotLightTarget");
-        glUniform3fv(spotLightTargetLoc, 1, glm::value_ptr(spotLight->getLightTarget()));
-
-        cutOffAngleLoc = glGetUniformLocation(shader.shaderProgram, "cutOffAngle");
-        glUniform1f(cutOffAngleLoc, cos(glm::radians(spotLightsCutOffAngle)));
-    }
-    else if (currentShader == NIGHT_LIGHTS) {
-        for (int i = 0; i < NO_NIGHT_LIGHTS; i++) {
-            // night light positions
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, nightLightPositionsUniform[i]), 1, glm::value_ptr(nightLightPositions[i]));
-            // night light targets
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, nightLightTargetUniform[i]), 1, glm::value_ptr(nightLightTargets[i]));
-        }
-
-        for (int i = 0; i < 4; i++) {
-            // reflector light positions
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, reflectorLightPositionsUniform[i]), 1, glm::value_ptr(reflectorLightPositions[i]));
-            // reflector light targets
-            glUniform3fv(glGetUniformLocation(shader.shaderProgram, reflectorLightTargetsUniform[i]), 1, glm::value_ptr(reflectorLightTargets[i]));
-        }
-
-        cutOffAngleLoc = glGetUniformLocation(shader.shaderProgram, "cutOffAngle");
-        glUniform1f(glGetUniformLocation(shader.shaderProgram, "cutOffAngle"), cos(glm::radians(nightLightsCutOffAngle)));
-        glUniform1f(glGetUniformLocation(shader.shaderProgram, "ambientStrength"), daylightIntensity);
-    }
-    else {
-        // send light dir to shader
-        lightDirLoc = glGetUniformLocation(shader.shaderProgram, "lightDir");
-        glUniform3fv(lightDirLoc, 1, glm::value_ptr(directionalLight->getLightDir()));
-    }
-
+    // the lights are sent by the light buffer
 }
 
 void initUniforms() {
-    // init the uniform matrices for the basic shader
-    initUniformsForShader(basicShader);
+    // init the uniform matrices for the lighting shader
+    initUniformsForShader(lightingShader);
 
     // send the projection matrix to the light shader
     lightShader.useShaderProgram();
@@ -951,6 +1225,47 @@ void initLightSources() {
     pointLightMiddle = new LightSource(initialPointLightMiddlePosition, ballInitialPosition, WHITE_COLOUR);
     pointLightLeft = new LightSource(initialPointLightLeftPosition, ballInitialPosition, WHITE_COLOUR);
     pointLightRight = new LightSource(initialPointLightRightPosition, ballInitialPosition, WHITE_COLOUR);
+
+    // ambient and specular strength of the lights
+    directionalLight->setLightAttributes(0.45f, 0.75f);
+    flashLight->setLightAttributes(0.45f, 0.25f);
+    spotLight->setLightAttributes(1.0f, 0.25f);
+    for (int i = 0; i < NO_NIGHT_LIGHTS; i++) {
+        nightLights[i]->setLightAttributes(1.0f, 0.25f);
+    }
+    for (int i = 0; i < 4; i++) {
+        reflectorLights[i]->setLightAttributes(1.0f, 0.25f);
+    }
+    pointLightMiddle->setLightAttributes(0.55f, 0.2f);
+    pointLightLeft->setLightAttributes(0.55f, 0.2f);
+    pointLightRight->setLightAttributes(0.55f, 0.2f);
+
+    // the attenuation gives the range of the lights
+    spotLight->setAttenuation(SPOT_LIGHT_ATTENUATION);
+    for (int i = 0; i < NO_NIGHT_LIGHTS; i++) {
+        nightLights[i]->setAttenuation(SPOT_LIGHT_ATTENUATION);
+    }
+    for (int i = 0; i < 4; i++) {
+        reflectorLights[i]->setAttenuation(SPOT_LIGHT_ATTENUATION);
+    }
+    pointLightMiddle->setAttenuation(POINT_LIGHT_ATTENUATION);
+    pointLightLeft->setAttenuation(POINT_LIGHT_ATTENUATION);
+    pointLightRight->setAttenuation(POINT_LIGHT_ATTENUATION);
+
+    // always the same lights, the measures can be compared
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int maxExtraLights = EXTRA_LIGHT_COUNTS[NO_EXTRA_LIGHT_COUNTS - 1];
+    for (int i = 0; i < maxExtraLights; i++) {
+        glm::vec3 position = glm::vec3((unit(random) - 0.5f) * BASKETBALL_COURT_LENGTH, 2.0f + 6.0f * unit(random), (unit(random) - 0.5f) * BASKETBALL_COURT_WIDTH);
+        glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+        extraPointLights.push_back(LightSource(position, position - glm::vec3(0.0f, 1.0f, 0.0f), color));
+        extraPointLights.back().setLightAttributes(0.0f, 0.2f);
+        extraPointLights.back().setAttenuation(EXTRA_LIGHT_ATTENUATION);
+    }
+
+    lightBuffer.init();
+    lightCuller.init();
 }
 
 void initFBO() {
@@ -959,11 +1274,14 @@ void initFBO() {
     glGenFramebuffers(1, &shadowMapFBO);
     //create depth texture for FBO 
     glGenTextures(1, &depthMapTexture);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+    gps::GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, depthMapTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
         SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // sampled by a sampler2DShadow: the texture compares the depths, with linear filtering over 2x2 texels
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -974,6 +1292,10 @@ void initFBO() {
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    shadowAtlas.init();
+    gBuffer.init();
+    dynamicResolution.init();
 }
 
 void initSkyBox() {
@@ -993,10 +1315,10 @@ void windowResizeCallback(GLFWwindow* window, int width, int height) {
         return;
     }
     glfwGetFramebufferSize(window, &retina_width, &retina_height);
-    basicShader.useShaderProgram();
+    lightingShader.useShaderProgram();
 
     projection = glm::perspective(glm::radians(45.0f), (float)retina_width / (float)retina_height, 0.1f, 1000.0f);
-    projectionLoc = glGetUniformLocation(basicShader.shaderProgram, "projection");
+    projectionLoc = glGetUniformLocation(lightingShader.shaderProgram, "projection");
     // send projection matrix to shader
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
@@ -1007,6 +1329,72 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+        // print the texture memory usage
+        gps::TextureResidency::getInstance().printStats(std::cout);
+    }
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+        // print the draw calls and state changes of the last frame
+        renderQueue.printStats(std::cout);
+        std::cout << "Draw calls: " << sceneDrawCommands.getSubmitCount() << " for " << sceneDrawCommands.getCommandCount() << " command(s)" << std::endl;
+        gps::GLStateCache::getInstance().printStats(std::cout);
+        gps::ShaderPermutationCache::getInstance().printStats(std::cout);
+        std::cout << "Lights: " << lightBuffer.getLightCount() << " (" << lightBuffer.getCulledLightCount() << " culled), light buffer uploads: " << lightBuffer.getUploadCount() << std::endl;
+        shadowAtlas.printStats(std::cout);
+        if (tiledLightCulling) {
+            lightCuller.printStats(std::cout);
+        }
+        dynamicResolution.printStats(std::cout);
+        lightingPassTimer.finish();
+        std::cout << "Lighting pass: " << lightingPassTimer.getAverageMilliseconds() << " ms (GPU, average of " << lightingPassTimer.getSampleCount() << " frames)"
+            << ", depth pre-pass " << (isDepthPrepassUsed() ? "on" : "off") << std::endl;
+        lightingPassTimer.reset();
+        std::cout << "Shaded fragments per pixel: " << getShadedFragmentsPerPixel() << std::endl;
+    }
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        // switch between the permutations of the lighting shaders with and without shadows
+        shadowsEnabled = !shadowsEnabled;
+        std::cout << "Shadows " << (shadowsEnabled ? "on" : "off") << std::endl;
+        initUniformsForShader(*getSelectedShader());
+    }
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        // number of filtered shadow map comparisons per fragment
+        pcfTapCountIndex = (pcfTapCountIndex + 1) % NO_PCF_TAP_COUNTS;
+        std::cout << "Shadow filter: " << PCF_TAP_COUNTS[pcfTapCountIndex] << " tap(s)" << std::endl;
+        initUniformsForShader(*getSelectedShader());
+    }
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+        depthPrepassEnabled = !depthPrepassEnabled;
+        std::cout << "Depth pre-pass " << (depthPrepassEnabled ? "on" : "off")
+            << " (used from " << DEPTH_PREPASS_MIN_LIGHTS << " lights)" << std::endl;
+    }
+    if (key == GLFW_KEY_F6 && action == GLFW_PRESS) {
+        // overdraw visualization: each shaded fragment adds the same brightness
+        showOverdraw = !showOverdraw;
+        std::cout << "Overdraw view " << (showOverdraw ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_F7 && action == GLFW_PRESS) {
+        deferredShading = !deferredShading;
+        std::cout << (deferredShading ? "Deferred" : "Forward") << " shading" << std::endl;
+        initUniformsForShader(*getSelectedShader());
+    }
+    if (key == GLFW_KEY_F8 && action == GLFW_PRESS) {
+        extraLightCountIndex = (extraLightCountIndex + 1) % NO_EXTRA_LIGHT_COUNTS;
+        std::cout << "Extra point lights: " << EXTRA_LIGHT_COUNTS[extraLightCountIndex] << std::endl;
+    }
+    if (key == GLFW_KEY_F9 && action == GLFW_PRESS) {
+        tiledLightCulling = !tiledLightCulling;
+        std::cout << "Tiled light culling " << (tiledLightCulling ? "on" : "off") << std::endl;
+        initUniformsForShader(*getSelectedShader());
+    }
+    if (key == GLFW_KEY_F10 && action == GLFW_PRESS) {
+        lightRangeCulling = !lightRangeCulling;
+        std::cout << "Light range culling " << (lightRangeCulling ? "on" : "off") << std::endl;
+    }
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS) {
+        dynamicResolution.setEnabled(!dynamicResolution.isEnabled());
+        std::cout << "Dynamic resolution " << (dynamicResolution.isEnabled() ? "on" : "off") << std::endl;
+    }
     if (key >= 0 && key < 1024) {
         if (action == GLFW_PRESS) {
             pressedKeys[key] = true;
@@ -1070,6 +1458,18 @@ void rotateCamera(float xOffset, float yOffset) {
 }
 
 void cleanup() {
+    shaderWatcher.stop();
+    gps::ShaderPermutationCache::getInstance().destroy();
+    sceneDrawCommands.destroy();
+    lightBuffer.destroy();
+    lightCuller.destroy();
+    lightingPassTimer.destroy();
+    shadedSamplesCounter.destroy();
+    shadowAtlas.destroy();
+    gBuffer.destroy();
+    dynamicResolution.destroy();
+    gps::ScreenTriangle::getInstance().destroy();
+    gps::MaterialLibrary::getInstance().destroy();
     glDeleteTextures(1, &depthMapTexture);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDeleteFramebuffers(1, &shadowMapFBO);
@@ -1112,7 +1512,7 @@ GLenum glCheckError_(const char* file, int line)
 }
 
 void initOpenGLWindow() {
-    myWindow.Create(myWindowWidth, myWindowHeight, "OpenGL Project");
+    myWindow.Create(myWindowWidth, myWindowHeight, "OpenGL Project", !benchmarkMode);
 }
 
 void setWindowCallbacks() {
@@ -1128,8 +1528,154 @@ void initOpenGLState() {
     glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
     glEnable(GL_FRAMEBUFFER_SRGB);
     glEnable(GL_DEPTH_TEST); // enable depth-testing
-    glDepthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
+    gps::GLStateCache::getInstance().depthFunc(GL_LESS); // depth-testing interprets a smaller value as "closer"
     glEnable(GL_CULL_FACE); // cull face
     glCullFace(GL_BACK); // cull back face
     glFrontFace(GL_CCW); // GL_CCW for counter clock-wise
+    lightingPassTimer.init();
+    shadedSamplesCounter.init();
+}
+
+bool isDepthPrepassUsed() {
+    // the deferred shading lights each pixel once anyway
+    return !deferredShading && depthPrepassEnabled && lightBuffer.getLightCount() >= DEPTH_PREPASS_MIN_LIGHTS;
+}
+
+// average number of fragments shaded by the lighting pass for each pixel of the screen, then resets the counter
+double getShadedFragmentsPerPixel() {
+    shadedSamplesCounter.finish();
+    // with multisampling every covered sample is counted
+    GLint samples = 0;
+    glGetIntegerv(GL_SAMPLES, &samples);
+    double pixels = (double)dynamicResolution.getRenderWidth() * dynamicResolution.getRenderHeight() * std::max(1, (int)samples);
+    double fragments = shadedSamplesCounter.getAverageResult() / pixels;
+    shadedSamplesCounter.reset();
+    return fragments;
+}
+
+double measureLightingPass() {
+    // with the current mode and permutation
+    initUniformsForShader(*getSelectedShader());
+    for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES; frame++) {
+        if (frame == BENCHMARK_WARMUP_FRAMES) {
+            lightingPassTimer.reset();
+            shadedSamplesCounter.reset();
+        }
+        renderScene();
+        // nothing is presented, the frames are only submitted
+        glFlush();
+    }
+    lightingPassTimer.finish();
+    return lightingPassTimer.getAverageMilliseconds();
+}
+
+void initBenchmarkFramebuffer(int width, int height) {
+    // as many samples as the window would have, the results match the interactive frames
+    GLint samples = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGetIntegerv(GL_SAMPLES, &samples);
+
+    glGenRenderbuffers(1, &benchmarkColorRenderbuffer);
+    glGenRenderbuffers(1, &benchmarkDepthRenderbuffer);
+    // sRGB like the window (GL_FRAMEBUFFER_SRGB)
+    glBindRenderbuffer(GL_RENDERBUFFER, benchmarkColorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_SRGB8_ALPHA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, benchmarkDepthRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &benchmarkFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, benchmarkFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, benchmarkColorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, benchmarkDepthRenderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Benchmark: incomplete framebuffer" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    dynamicResolution.setOutputFramebuffer(benchmarkFramebuffer);
+}
+
+void destroyBenchmarkFramebuffer() {
+    dynamicResolution.setOutputFramebuffer(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &benchmarkFramebuffer);
+    glDeleteRenderbuffers(1, &benchmarkDepthRenderbuffer);
+    glDeleteRenderbuffers(1, &benchmarkColorRenderbuffer);
+    benchmarkFramebuffer = 0;
+    benchmarkDepthRenderbuffer = 0;
+    benchmarkColorRenderbuffer = 0;
+}
+
+void runBenchmark() {
+    // same order as SHADER_TYPE
+    const char* modeNames[] = { "directional", "flash light", "spot light", "point lights", "night lights" };
+
+    // the requested size, whatever the window system made of the hidden window
+    retina_width = myWindowWidth;
+    retina_height = myWindowHeight;
+    initBenchmarkFramebuffer(retina_width, retina_height);
+
+    std::cout << "Benchmark: GPU time of the lighting pass at " << retina_width << "x" << retina_height
+        << ", eye space per vertex vs per fragment" << std::endl;
+    for (int mode = BASIC; mode <= NIGHT_LIGHTS; mode++) {
+        currentShader = (SHADER_TYPE)mode;
+        double milliseconds[2];
+        for (int permutation = 0; permutation < 2; permutation++) {
+            vertexEyeSpace = permutation == 0;
+            milliseconds[permutation] = measureLightingPass();
+        }
+        std::cout << modeNames[mode] << " (" << lightBuffer.getLightCount() << " light(s)): "
+            << milliseconds[0] << " ms per vertex, " << milliseconds[1] << " ms per fragment";
+        if (milliseconds[1] > 0.0) {
+            std::cout << ", " << 100.0 * (1.0 - milliseconds[0] / milliseconds[1]) << "% saved";
+        }
+        std::cout << std::endl;
+    }
+    vertexEyeSpace = true;
+
+    // cost of the shadow filter, with the directional light
+    std::cout << "Shadow filter at " << SHADOW_WIDTH << "x" << SHADOW_HEIGHT << ":";
+    currentShader = BASIC;
+    int defaultTapCountIndex = pcfTapCountIndex;
+    for (pcfTapCountIndex = 0; pcfTapCountIndex < NO_PCF_TAP_COUNTS; pcfTapCountIndex++) {
+        std::cout << " " << PCF_TAP_COUNTS[pcfTapCountIndex] << " tap(s) " << measureLightingPass() << " ms";
+    }
+    std::cout << std::endl;
+    pcfTapCountIndex = defaultTapCountIndex;
+
+    // the night lights shade every fragment with the most lights
+    std::cout << "Depth pre-pass, night lights:";
+    currentShader = NIGHT_LIGHTS;
+    for (int enabled = 0; enabled < 2; enabled++) {
+        depthPrepassEnabled = enabled == 1;
+        double milliseconds = measureLightingPass();
+        std::cout << " " << (depthPrepassEnabled ? "on " : "off ") << milliseconds << " ms, "
+            << getShadedFragmentsPerPixel() << " shaded fragments per pixel;";
+    }
+    std::cout << std::endl;
+    depthPrepassEnabled = true;
+
+    // the rest of the frame is the same for both, the lighting pass includes the depth pre-pass or the G-buffer pass;
+    // every light for every fragment (brute force) against the lights of the tiles
+    std::cout << "Forward vs deferred shading, point lights with extra lights, all lights / tiled:" << std::endl;
+    currentShader = POINT_LIGHTS;
+    for (extraLightCountIndex = 1; extraLightCountIndex < NO_EXTRA_LIGHT_COUNTS; extraLightCountIndex++) {
+        double milliseconds[2][2];
+        for (int deferred = 0; deferred < 2; deferred++) {
+            deferredShading = deferred == 1;
+            for (int tiled = 0; tiled < 2; tiled++) {
+                tiledLightCulling = tiled == 1;
+                milliseconds[deferred][tiled] = measureLightingPass();
+            }
+        }
+        std::cout << "  " << lightBuffer.getLightCount() << " lights: forward " << milliseconds[0][0] << " / " << milliseconds[0][1]
+            << " ms, deferred " << milliseconds[1][0] << " / " << milliseconds[1][1] << " ms, culling "
+            << lightCuller.getCullMilliseconds() << " ms (CPU)" << std::endl;
+    }
+    extraLightCountIndex = 0;
+    deferredShading = false;
+    tiledLightCulling = true;
+    currentShader = BASIC;
+    destroyBenchmarkFramebuffer();
+    glCheckError();
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#version 410 core
+#include "include/options.glsl"
+
+out vec4 fColor;
+
+// the G-buffer (see GBuffer), one texel per pixel
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+// the eye space positions are reconstructed from the depths
+uniform mat4 inverseProjection;
+// pixels of the scene, in the lower left corner of the G-buffer (see DynamicResolution)
+uniform vec2 viewportSize;
+// from eye space to the clip space of the directional light
+uniform mat4 eyeToLightSpace;
+
+#include "include/materialTable.glsl"
+#include "include/octahedral.glsl"
+
+// the surface of the pixel, read once for all the lights
+vec4 surfacePosEye;
+vec3 surfaceNormalEye;
+vec3 surfaceDiffuse;
+vec3 surfaceSpecular;
+int surfaceMaterial;
+
+vec4 fragmentPositionEye()
+{
+    return surfacePosEye;
+}
+
+vec3 fragmentNormalEye()
+{
+    return surfaceNormalEye;
+}
+
+#if SHADOWS
+vec4 fragmentPositionLightSpace()
+{
+    return eyeToLightSpace * surfacePosEye;
+}
+#endif
+
+float materialShininess()
+{
+    return materials[surfaceMaterial].specular.w;
+}
+
+// shadeMaterial of material.glsl, with the colors of the G-buffer
+vec3 shadeMaterial(vec3 ambient, vec3 diffuse, vec3 specular)
+{
+    return min((ambient * materials[surfaceMaterial].ambient.rgb + diffuse) * surfaceDiffuse + specular * surfaceSpecular, 1.0f);
+}
+
+#include "include/shadow.glsl"
+#include "include/lights.glsl"
+
+// every visible pixel is lit once, by all the lights of the light buffer
+void main() 
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    // no object, the skybox is drawn there later
+    if (depth == 1.0f) {
+        discard;
+    }
+
+    vec2 ndc = gl_FragCoord.xy / viewportSize * 2.0f - 1.0f;
+    vec4 posEye = inverseProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+    surfacePosEye = vec4(posEye.xyz / posEye.w, 1.0f);
+    surfaceNormalEye = decodeOctahedral(texelFetch(gNormal, pixel, 0).rg * 2.0f - 1.0f);
+    surfaceDiffuse = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+    surfaceSpecular = specular.rgb;
+    surfaceMaterial = int(specular.a * 255.0f + 0.5f);
+
+    vec3 color = computeLights();
+    fColor = vec4(min(color, 1.0f), 1.0f);
+
+    // the light cubes and the skybox are depth tested against the scene
+    gl_FragDepth = depth;
+}
@@ -5,7 +5,12 @@ layout(location=0) in vec3 vPosition;
 uniform mat4 lightSpaceTrMatrix; 
 uniform mat4 model; 
 
+// dequantization of compact vertex positions (identity for full float vertices)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
 void main() 
 { 
-    gl_Position = lightSpaceTrMatrix * model * vec4(vPosition, 1.0f);
+    vec3 position = positionOffset + positionScale * vPosition;
+    gl_Position = lightSpaceTrMatrix * model * vec4(position, 1.0f);
 }
\ No newline at end of file
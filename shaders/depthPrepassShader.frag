@@ -0,0 +1,6 @@
+#version 410 core
+
+// only the depth is written (the color writes are masked)
+void main() 
+{
+}
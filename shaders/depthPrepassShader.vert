@@ -0,0 +1,21 @@
+#version 410 core
+
+layout(location=0) in vec3 vPosition;
+
+// the same computation as in the lighting shader, so the depths match exactly for the GL_EQUAL test
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// dequantization of compact vertex positions (identity for full float vertices)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main() 
+{
+	vec3 position = positionOffset + positionScale * vPosition;
+	vec4 posEye = view * model * vec4(position, 1.0f);
+	gl_Position = projection * posEye;
+}
@@ -0,0 +1,25 @@
+#version 410 core
+#include "include/options.glsl"
+
+// from lightingShader.vert (VERTEX_EYE_SPACE permutation)
+in vec3 fPosEye;
+in vec3 fNormalEye;
+in vec2 fTexCoords;
+flat in uint fMaterialIndex;
+
+// the targets of the G-buffer (see GBuffer), lit later by deferredLightingShader
+layout(location=0) out vec4 gAlbedo;
+layout(location=1) out vec4 gSpecular;
+layout(location=2) out vec2 gNormal;
+
+#include "include/material.glsl"
+#include "include/octahedral.glsl"
+
+void main() 
+{
+    MaterialData material = materials[fMaterialIndex];
+    gAlbedo = vec4(materialColor(diffuseTextures, material.textureLayers.y, material.diffuse.rgb), 1.0f);
+    // the ambient color and the shininess are read from the material table, the 8 bit alpha holds its index exactly
+    gSpecular = vec4(materialColor(specularTextures, material.textureLayers.z, material.specular.rgb), float(fMaterialIndex) / 255.0f);
+    gNormal = encodeOctahedral(normalize(fNormalEye)) * 0.5f + 0.5f;
+}
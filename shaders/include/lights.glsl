@@ -0,0 +1,215 @@
+// lights of the scene, from the light buffer (see LightBuffer); the including shader gives the surface
+// being lit: fragmentPositionEye(), fragmentNormalEye() and fragmentPositionLightSpace() (the position in the
+// clip space of the directional light), with materialShininess() and shadeMaterial()
+
+#define LIGHT_DIRECTIONAL 0
+#define LIGHT_POINT 1
+#define LIGHT_SPOT 2
+#define LIGHT_FLASH 3
+
+#define SHADOW_NONE 0
+#define SHADOW_MAP 1
+#define SHADOW_ATLAS 2
+
+// see LightBuffer
+struct LightData
+{
+    // xyz - eye space position (direction towards the light for directional and flash lights), w - type
+    vec4 position;
+    // xyz - eye space direction from the target to a spot light (front direction of the camera for the
+    // flash light), w - cosine of the cut-off angle
+    vec4 target;
+    // rgb - color, w - ambient strength
+    vec4 color;
+    // constant, linear and quadratic attenuation, w - cosine of the outer cone
+    vec4 attenuation;
+    // x - specular strength, y - shadow map of the light (SHADOW_*), z - radius, negative if unlimited
+    vec4 parameters;
+    // offset (xy) and scale (zw) of the tile in the shadow atlas
+    vec4 shadowRect;
+    // from eye space to the clip space of the light's shadow map in the atlas
+    mat4 shadowMatrix;
+};
+
+// the lights, one LightData in LIGHT_TEXELS consecutive RGBA32F texels
+uniform samplerBuffer lightData;
+uniform int lightCount;
+
+#define LIGHT_TEXELS 10
+
+LightData fetchLight(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    LightData light;
+    light.position = texelFetch(lightData, base);
+    light.target = texelFetch(lightData, base + 1);
+    light.color = texelFetch(lightData, base + 2);
+    light.attenuation = texelFetch(lightData, base + 3);
+    light.parameters = texelFetch(lightData, base + 4);
+    // the tile and the matrix are only read for the lights shadowed from the atlas
+    light.shadowRect = vec4(0.0f);
+    light.shadowMatrix = mat4(1.0f);
+    if (int(light.parameters.y) == SHADOW_ATLAS) {
+        light.shadowRect = texelFetch(lightData, base + 5);
+        light.shadowMatrix = mat4(texelFetch(lightData, base + 6), texelFetch(lightData, base + 7),
+            texelFetch(lightData, base + 8), texelFetch(lightData, base + 9));
+    }
+    return light;
+}
+
+float computeLightShadow(LightData light, vec3 normalEye, vec3 lightDirEye)
+{
+#if SHADOWS
+    int shadowSource = int(light.parameters.y);
+    if (shadowSource == SHADOW_MAP) {
+        return computeShadow(fragmentPositionLightSpace(), normalEye, lightDirEye);
+    }
+    if (shadowSource == SHADOW_ATLAS) {
+        return computeAtlasShadow(light.shadowMatrix * fragmentPositionEye(), light.shadowRect, normalEye, lightDirEye);
+    }
+#endif
+    return 0.0f;
+}
+
+// Phong lighting from a direction (normalized, in eye space), dimmed by the shadow
+vec3 computeDirLight(LightData light, vec3 lightDirN)
+{
+    //compute eye space coordinates
+    vec4 posEye = fragmentPositionEye();
+    vec3 normalEye = fragmentNormalEye();
+
+    //compute view direction (in eye coordinates, the viewer is situated at the origin
+    vec3 viewDir = normalize(- posEye.xyz);
+
+    //compute ambient light
+    vec3 ambient = light.color.w * light.color.rgb;
+
+    //compute diffuse light
+    vec3 diffuse = max(dot(normalEye, lightDirN), 0.0f) * light.color.rgb;
+
+    //compute specular light
+    vec3 reflectDir = reflect(-lightDirN, normalEye);
+    float specCoeff = pow(max(dot(viewDir, reflectDir), 0.0f), materialShininess());
+    vec3 specular = light.parameters.x * specCoeff * light.color.rgb;
+
+    float shadow = computeLightShadow(light, normalEye, lightDirN);
+    return shadeMaterial(ambient, (1.0 - shadow) * diffuse, (1.0 - shadow) * specular);
+}
+
+// attenuated Blinn-Phong lighting from a position
+vec3 computePointLight(LightData light)
+{
+    //compute eye space coordinates
+    vec4 posEye = fragmentPositionEye();
+    vec3 normalEye = fragmentNormalEye();
+
+    //compute view direction (in eye coordinates, the viewer is situated at the origin
+    vec3 viewDirN = normalize(- posEye.xyz);
+
+    //normalize light direction
+    vec3 lightDirN = normalize(light.position.xyz - posEye.xyz);
+
+    //compute distance to light 
+    float dist = length(light.position.xyz - posEye.xyz); 
+
+    // beyond its radius the light is too dim to be seen, as in the culled tiles
+    if (light.parameters.z >= 0.0f && dist > light.parameters.z) {
+        return vec3(0.0f);
+    }
+
+    //compute attenuation 
+    float att = 1.0f / (light.attenuation.x + light.attenuation.y * dist + light.attenuation.z * (dist * dist));
+
+    //compute half vector 
+    vec3 halfVector = normalize(lightDirN + viewDirN);
+
+    //compute ambient light
+    vec3 ambient = att * light.color.w * light.color.rgb;
+
+    //compute diffuse light
+    vec3 diffuse = att * max(dot(normalEye, lightDirN), 0.0f) * light.color.rgb;
+
+    //compute specular light 
+    float specCoeff = pow(max(dot(normalEye, halfVector), 0.0f), materialShininess()); 
+    vec3 specular = att * light.parameters.x * specCoeff * light.color.rgb;
+
+    float shadow = computeLightShadow(light, normalEye, lightDirN);
+    return shadeMaterial(ambient, (1.0 - shadow) * diffuse, (1.0 - shadow) * specular);
+}
+
+// fades from the cut-off angle to the outer cone
+float computeConeIntensity(LightData light, float theta)
+{
+    if (theta > light.target.w) {
+        return 1.0f;
+    }
+    return (theta - light.attenuation.w) / (light.target.w - light.attenuation.w);
+}
+
+vec3 computeSpotLight(LightData light)
+{
+    //compute eye space coordinates
+    vec4 posEye = fragmentPositionEye();
+
+    //normalize light direction
+    vec3 lightDirN = normalize(light.position.xyz - posEye.xyz);
+
+    // the target holds the direction from the target to the light
+    float theta = dot(lightDirN, light.target.xyz);
+
+    return computeConeIntensity(light, theta) * computePointLight(light);
+}
+
+vec3 computeFlashLight(LightData light)
+{
+    //compute eye space coordinates
+    vec4 posEye = fragmentPositionEye();
+
+    //compute view direction (in eye coordinates, the viewer is situated at the origin)
+    vec3 viewDirN = normalize(- posEye.xyz);
+
+    // compute the teta angle's cosine (using the dot product between the direction from the fragment to the light source and the spotlight's orientation)
+    float theta = dot(light.position.xyz, normalize(light.target.xyz - viewDirN));
+
+    return computeConeIntensity(light, theta) * computeDirLight(light, light.position.xyz);
+}
+
+// the positions and directions of the lights are already in eye space (see LightBuffer::setViewMatrix)
+vec3 computeLight(LightData light)
+{
+    int type = int(light.position.w);
+    if (type == LIGHT_POINT) {
+        return computePointLight(light);
+    }
+    if (type == LIGHT_SPOT) {
+        return computeSpotLight(light);
+    }
+    if (type == LIGHT_FLASH) {
+        return computeFlashLight(light);
+    }
+    // directional lights store their direction as position
+    return computeDirLight(light, light.position.xyz);
+}
+
+#if TILED_LIGHTS
+// offset and count of the lights of every tile in lightIndices
+uniform usampler2D lightTiles;
+uniform usamplerBuffer lightIndices;
+#endif
+
+// sum of the lights reaching the fragment
+vec3 computeLights()
+{
+    vec3 color = vec3(0.0f);
+#if TILED_LIGHTS
+    uvec2 tile = texelFetch(lightTiles, ivec2(gl_FragCoord.xy) / LIGHT_TILE_SIZE, 0).rg;
+    for (uint i = 0u; i < tile.y; i++) {
+        color += computeLight(fetchLight(int(texelFetch(lightIndices, int(tile.x + i)).r)));
+    }
+#else
+    for (int i = 0; i < lightCount; i++) {
+        color += computeLight(fetchLight(i));
+    }
+#endif
+    return color;
+}
@@ -0,0 +1,28 @@
+// materials of the scene, indexed by fMaterialIndex (the including shader declares fTexCoords and fMaterialIndex)
+
+#include "materialTable.glsl"
+
+// textures of the materials, one texture array per kind
+uniform sampler2DArray diffuseTextures;
+uniform sampler2DArray specularTextures;
+
+// the texture of the material replaces its color, if it has one
+vec3 materialColor(sampler2DArray textures, int layer, vec3 color)
+{
+    if (layer < 0) {
+        return color;
+    }
+    return texture(textures, vec3(fTexCoords, float(layer))).rgb;
+}
+
+float materialShininess()
+{
+    return materials[fMaterialIndex].specular.w;
+}
+
+// final color of the fragment lit by the given light components
+vec3 shadeMaterial(vec3 ambient, vec3 diffuse, vec3 specular)
+{
+    MaterialData material = materials[fMaterialIndex];
+    return min((ambient * material.ambient.rgb + diffuse) * materialColor(diffuseTextures, material.textureLayers.y, material.diffuse.rgb) + specular * materialColor(specularTextures, material.textureLayers.z, material.specular.rgb), 1.0f);
+}
@@ -0,0 +1,17 @@
+// table of the materials of the scene (see MaterialLibrary), indexed by the material index of the draw
+
+// std140, see MaterialLibrary
+struct MaterialData
+{
+    vec4 ambient;
+    vec4 diffuse;
+    // shininess in w
+    vec4 specular;
+    // layers of the ambient, diffuse and specular textures (-1 if there is none)
+    ivec4 textureLayers;
+};
+
+layout(std140) uniform Materials
+{
+    MaterialData materials[64];
+};
@@ -0,0 +1,33 @@
+// compile-time options of the lighting shader, the application overrides them per permutation
+// (see ShaderPreprocessor); code disabled by an option is not compiled at all
+
+// sample the shadow map of the directional light
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
+// the shadow test is averaged over PCF_TAPS comparisons on a rotated Poisson disk (1 to 16, 1 - a single comparison)
+#ifndef PCF_TAPS
+#define PCF_TAPS 8
+#endif
+
+// radius of the Poisson disk, in shadow map texels
+#ifndef PCF_RADIUS
+#define PCF_RADIUS 1.5
+#endif
+
+// eye space position and normal computed once per vertex (0 - recomputed in the fragment shader by every light)
+#ifndef VERTEX_EYE_SPACE
+#define VERTEX_EYE_SPACE 1
+#endif
+
+// only the lights binned into the screen tile of the fragment are computed (see TiledLightCuller),
+// 0 - every light of the light buffer for every fragment
+#ifndef TILED_LIGHTS
+#define TILED_LIGHTS 1
+#endif
+
+// size of the light tiles in pixels (TiledLightCuller::TILE_SIZE)
+#ifndef LIGHT_TILE_SIZE
+#define LIGHT_TILE_SIZE 16
+#endif
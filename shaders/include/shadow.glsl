@@ -0,0 +1,89 @@
+// shadows of the directional light (its own shadow map) and of the spot lights (tiles of the shadow atlas),
+// see SHADOWS, PCF_TAPS and PCF_RADIUS in options.glsl
+
+// depth comparison done by the sampler (GL_COMPARE_REF_TO_TEXTURE), linear filtering blends 2x2 comparisons
+uniform sampler2DShadow shadowMap;
+uniform sampler2DShadow shadowAtlas;
+
+#if PCF_TAPS > 1
+// Poisson disk in the unit circle, the first PCF_TAPS taps are used
+const vec2 poissonDisk[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+#endif
+
+// fraction of the filtered comparisons in shadow; the taps stay within bounds (min xy, max zw)
+float filterShadow(sampler2DShadow map, vec2 coords, float reference, vec4 bounds)
+{
+#if PCF_TAPS > 1
+	// the disk is rotated per pixel (interleaved gradient noise), which turns the banding of the few taps into fine noise
+	float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+	vec2 radius = PCF_RADIUS / vec2(textureSize(map, 0));
+
+	// fraction of the taps closer to the light
+	float lit = 0.0;
+	for (int i = 0; i < PCF_TAPS; i++) {
+		vec2 tap = clamp(coords + rotation * poissonDisk[i] * radius, bounds.xy, bounds.zw);
+		lit += texture(map, vec3(tap, reference));
+	}
+	return 1.0 - lit / float(PCF_TAPS);
+#else
+	// a single comparison, still filtered over 2x2 texels by the sampler
+	return 1.0 - texture(map, vec3(clamp(coords, bounds.xy, bounds.zw), reference));
+#endif
+}
+
+// 1 if the fragment is in shadow, 0 if it is lit; the normal and the light direction are in eye space
+float computeShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
+{
+#if SHADOWS
+	// perform perspective divide 
+	vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+
+	// Transform to [0,1] range 
+	normalizedCoords = normalizedCoords * 0.5 + 0.5; 
+
+	// Get depth of current fragment from light's perspective 
+	float currentDepth = normalizedCoords.z;
+	
+	if (currentDepth > 1.0f) 
+		return 0.0f; 
+
+	float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);  
+
+	// outside of the map the border (depth 1) keeps the fragment lit
+	return filterShadow(shadowMap, normalizedCoords.xy, currentDepth - bias, vec4(-1.0, -1.0, 2.0, 2.0));
+#else
+	return 0.0f;
+#endif
+}
+
+// shadow from a tile of the atlas (offset xy, scale zw), fragPosShadow is in the clip space of the light
+float computeAtlasShadow(vec4 fragPosShadow, vec4 tile, vec3 normal, vec3 lightDir)
+{
+#if SHADOWS
+	vec3 normalizedCoords = fragPosShadow.xyz / fragPosShadow.w * 0.5 + 0.5;
+
+	// outside of the light's frustum - lit by the cone only
+	if (fragPosShadow.w <= 0.0 || any(lessThan(normalizedCoords, vec3(0.0))) || any(greaterThan(normalizedCoords, vec3(1.0))))
+		return 0.0f;
+
+	// the depths of a perspective projection are denser, the bias is smaller
+	float bias = max(0.0025 * (1.0 - dot(normal, lightDir)), 0.0005);
+
+	// the taps must not read the neighbouring tiles
+	vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+	vec4 bounds = vec4(tile.xy + halfTexel, tile.xy + tile.zw - halfTexel);
+	return filterShadow(shadowAtlas, tile.xy + normalizedCoords.xy * tile.zw, normalizedCoords.z - bias, bounds);
+#else
+	return 0.0f;
+#endif
+}
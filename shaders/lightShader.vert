@@ -8,7 +8,12 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// dequantization of compact vertex positions (identity for full float vertices)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
 void main() 
 {
-	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
+	vec3 position = positionOffset + positionScale * vPosition;
+	gl_Position = projection * view * model * vec4(position, 1.0f);
 }
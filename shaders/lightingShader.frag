@@ -0,0 +1,60 @@
+#version 410 core
+#include "include/options.glsl"
+
+#if VERTEX_EYE_SPACE
+in vec3 fPosEye;
+in vec3 fNormalEye;
+#else
+in vec3 fPosition;
+in vec3 fNormal;
+#endif
+in vec2 fTexCoords;
+flat in uint fMaterialIndex;
+#if SHADOWS
+in vec4 fragPosLightSpace;
+#endif
+
+out vec4 fColor;
+
+//matrices
+uniform mat4 model;
+uniform mat4 view;
+uniform mat3 normalMatrix;
+
+// eye space position and normal of the fragment
+vec4 fragmentPositionEye()
+{
+#if VERTEX_EYE_SPACE
+    return vec4(fPosEye, 1.0f);
+#else
+    return view * model * vec4(fPosition, 1.0f);
+#endif
+}
+
+vec3 fragmentNormalEye()
+{
+#if VERTEX_EYE_SPACE
+    return normalize(fNormalEye);
+#else
+    return normalize(normalMatrix * fNormal);
+#endif
+}
+
+#if SHADOWS
+vec4 fragmentPositionLightSpace()
+{
+    return fragPosLightSpace;
+}
+#endif
+
+#include "include/material.glsl"
+#include "include/shadow.glsl"
+#include "include/lights.glsl"
+
+// all the lighting modes: directional, flash, spot, night and point lights differ only by the light buffer
+void main() 
+{
+    vec3 color = computeLights();
+
+    fColor = vec4(min(color, 1.0f), 1.0f);
+}
@@ -0,0 +1,54 @@
+#version 410 core
+#include "include/options.glsl"
+
+layout(location=0) in vec3 vPosition;
+layout(location=1) in vec3 vNormal;
+layout(location=2) in vec2 vTexCoords;
+// index of the material in the material table, one per draw
+layout(location=3) in uint vMaterialIndex;
+
+#if VERTEX_EYE_SPACE
+out vec3 fPosEye;
+out vec3 fNormalEye;
+#else
+out vec3 fPosition;
+out vec3 fNormal;
+#endif
+out vec2 fTexCoords;
+flat out uint fMaterialIndex;
+#if SHADOWS
+out vec4 fragPosLightSpace;
+#endif
+
+// the depth pre-pass computes the same position (GL_EQUAL depth test)
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform mat4 lightSpaceTrMatrix; 
+
+// dequantization of compact vertex positions (identity for full float vertices)
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+void main() 
+{
+	vec3 position = positionOffset + positionScale * vPosition;
+	vec4 posEye = view * model * vec4(position, 1.0f);
+	gl_Position = projection * posEye;
+#if VERTEX_EYE_SPACE
+	// once per vertex instead of once per fragment and light
+	fPosEye = posEye.xyz;
+	fNormalEye = normalMatrix * vNormal;
+#else
+	fPosition = position;
+	fNormal = vNormal;
+#endif
+	fTexCoords = vTexCoords;
+	fMaterialIndex = vMaterialIndex;
+#if SHADOWS
+	fragPosLightSpace = lightSpaceTrMatrix * model * vec4(position, 1.0f);
+#endif
+}
@@ -0,0 +1,11 @@
+#version 410 core
+
+out vec4 fColor;
+
+// brightness added by every shaded fragment (additive blending): 1 / OVERDRAW_STEPS
+const float OVERDRAW_STEPS = 8.0f;
+
+void main() 
+{
+	fColor = vec4(vec3(1.0f / OVERDRAW_STEPS), 1.0f);
+}
@@ -0,0 +1,8 @@
+#version 410 core
+
+// a triangle covering the screen, from the index of the vertex (see ScreenTriangle)
+void main() 
+{
+	vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0f, float((gl_VertexID & 2) << 1) - 1.0f);
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
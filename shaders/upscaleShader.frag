@@ -0,0 +1,18 @@
+#version 410 core
+
+out vec4 fColor;
+
+// the scene rendered at a lower resolution, in the lower left corner of the texture (see DynamicResolution)
+uniform sampler2D sceneColor;
+// pixels of the scene and of the screen
+uniform vec2 renderSize;
+uniform vec2 outputSize;
+
+void main()
+{
+	vec2 sceneTextureSize = vec2(textureSize(sceneColor, 0));
+	vec2 position = gl_FragCoord.xy / outputSize * renderSize;
+	// the bilinear filter must not reach the texels outside of the scene
+	position = clamp(position, vec2(0.5f), renderSize - 0.5f);
+	fColor = vec4(texture(sceneColor, position / sceneTextureSize).rgb, 1.0f);
+}